@@ -0,0 +1,239 @@
+#include "AccessTrace.h"
+
+#include <cstring>
+#include <mutex>
+
+#define TRACE_MAGIC "VMTRACE"
+#define TRACE_MAGIC_LENGTH 7
+#define TRACE_HEADER_LENGTH (TRACE_MAGIC_LENGTH + 5)
+// the buffer is written out when it has less room than the largest record
+// without range words: the op byte and three varints of at most 10 bytes
+#define TRACE_BUFFER_BYTES (64 * 1024)
+#define MAX_RECORD_BYTES 31
+
+static uint64_t zigzag (int64_t value)
+{
+  return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static int64_t unzigzag (uint64_t value)
+{
+  return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+AccessTraceWriter::AccessTraceWriter ()
+    : file (NULL), io_failed (false), timestamps (false), previous_address (0),
+      previous_time (0)
+{}
+
+AccessTraceWriter::~AccessTraceWriter ()
+{
+  close ();
+}
+
+bool AccessTraceWriter::open (const char *path,
+                              const MemoryGeometry &geometry,
+                              bool timestamps)
+{
+  close ();
+  file = fopen (path, "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  io_failed = false;
+  this->timestamps = timestamps;
+  buffer.clear ();
+  buffer.reserve (TRACE_BUFFER_BYTES);
+  for (int i = 0; i < TRACE_MAGIC_LENGTH; ++i)
+  {
+    buffer.push_back ((uint8_t) TRACE_MAGIC[i]);
+  }
+  buffer.push_back (ACCESS_TRACE_VERSION);
+  buffer.push_back (timestamps ? ACCESS_TRACE_TIMESTAMPS : 0);
+  buffer.push_back ((uint8_t) geometry.offsetWidth);
+  buffer.push_back ((uint8_t) geometry.physicalAddressWidth);
+  buffer.push_back ((uint8_t) geometry.virtualAddressWidth);
+  previous_address = 0;
+  start = std::chrono::steady_clock::now ();
+  previous_time = 0;
+  return true;
+}
+
+void AccessTraceWriter::record (access_op op, uint64_t address,
+                                uint64_t value, bool failed,
+                                const word_t *words)
+{
+  std::lock_guard<Mutex> hold (lock);
+  if (file == NULL)
+  {
+    return;
+  }
+  if (buffer.size () + MAX_RECORD_BYTES > TRACE_BUFFER_BYTES)
+  {
+    flush ();
+  }
+
+  buffer.push_back ((uint8_t) ((uint8_t) failed << 2 | (uint8_t) op));
+  put_varint (zigzag ((int64_t) (address - previous_address)));
+  previous_address = address;
+  if (op == ACCESS_READ || op == ACCESS_WRITE)
+  {
+    put_varint (zigzag ((word_t) value));
+  }
+  else
+  {
+    put_varint (value);
+  }
+  if (timestamps)
+  {
+    uint64_t now = std::chrono::duration_cast<std::chrono::nanoseconds> (
+        std::chrono::steady_clock::now () - start).count ();
+    put_varint (now - previous_time);
+    previous_time = now;
+  }
+  if (op == ACCESS_WRITE_RANGE)
+  {
+    for (uint64_t i = 0; i < value; ++i)
+    {
+      if (buffer.size () + MAX_RECORD_BYTES > TRACE_BUFFER_BYTES)
+      {
+        flush ();
+      }
+      put_varint (zigzag (words[i]));
+    }
+  }
+}
+
+bool AccessTraceWriter::close ()
+{
+  std::lock_guard<Mutex> hold (lock);
+  if (file == NULL)
+  {
+    return false;
+  }
+  flush ();
+  if (fclose (file) != 0)
+  {
+    io_failed = true;
+  }
+  file = NULL;
+  return !io_failed;
+}
+
+void AccessTraceWriter::put_varint (uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    buffer.push_back ((uint8_t) (value | 0x80));
+    value >>= 7;
+  }
+  buffer.push_back ((uint8_t) value);
+}
+
+void AccessTraceWriter::flush ()
+{
+  if (!buffer.empty ()
+      && fwrite (buffer.data (), 1, buffer.size (), file) != buffer.size ())
+  {
+    io_failed = true;
+  }
+  buffer.clear ();
+}
+
+// decodes the varint at *position, returning false past the end of the data
+static bool get_varint (const std::vector<uint8_t> &data, size_t *position,
+                        uint64_t *value)
+{
+  *value = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    if (*position == data.size ())
+    {
+      return false;
+    }
+    uint8_t byte = data[(*position)++];
+    *value |= (uint64_t) (byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool read_access_trace (const char *path, access_trace *trace)
+{
+  FILE *file = fopen (path, "rb");
+  if (file == NULL)
+  {
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[TRACE_BUFFER_BYTES];
+  size_t length;
+  while ((length = fread (chunk, 1, sizeof (chunk), file)) != 0)
+  {
+    data.insert (data.end (), chunk, chunk + length);
+  }
+  bool read_error = ferror (file);
+  fclose (file);
+  if (read_error || data.size () < TRACE_HEADER_LENGTH
+      || memcmp (data.data (), TRACE_MAGIC, TRACE_MAGIC_LENGTH) != 0
+      || data[TRACE_MAGIC_LENGTH] != ACCESS_TRACE_VERSION)
+  {
+    return false;
+  }
+
+  const uint8_t *header = data.data () + TRACE_MAGIC_LENGTH + 1;
+  trace->timestamps = header[0] & ACCESS_TRACE_TIMESTAMPS;
+  trace->geometry = MemoryGeometry (header[1], header[2], header[3]);
+  trace->records.clear ();
+  trace->words.clear ();
+  if (!trace->geometry.isValid ())
+  {
+    return false;
+  }
+
+  size_t position = TRACE_HEADER_LENGTH;
+  uint64_t address = 0;
+  uint64_t time = 0;
+  while (position != data.size ())
+  {
+    access_record record;
+    uint8_t op = data[position++];
+    uint64_t address_delta, value, delta = 0;
+    if (op > (1 << 2 | ACCESS_WRITE_RANGE)
+        || !get_varint (data, &position, &address_delta)
+        || !get_varint (data, &position, &value)
+        || (trace->timestamps && !get_varint (data, &position, &delta)))
+    {
+      return false;
+    }
+    address += (uint64_t) unzigzag (address_delta);
+    time += delta;
+    record.op = (access_op) (op & 3);
+    record.failed = (op >> 2) & 1;
+    record.address = address;
+    record.value = value;
+    if (record.op == ACCESS_READ || record.op == ACCESS_WRITE)
+    {
+      record.value = (uint64_t) (int64_t) (word_t) unzigzag (value);
+    }
+    record.time = time;
+    if (record.op == ACCESS_WRITE_RANGE)
+    {
+      for (uint64_t i = 0; i < value; ++i)
+      {
+        uint64_t word;
+        if (!get_varint (data, &position, &word))
+        {
+          return false;
+        }
+        trace->words.push_back ((word_t) unzigzag (word));
+      }
+    }
+    trace->records.push_back (record);
+  }
+  return true;
+}
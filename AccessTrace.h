@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Locks.h"
+#include "MemoryGeometry.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/*
+ * binary traces of the accesses made to a virtual memory, recorded by
+ * VMstartRecording and replayed by Test/replay_trace.cpp.
+ *
+ * a trace is a header (the magic "VMTRACE", a version byte, a flags byte and
+ * the three address widths of the geometry, one byte each) followed by one
+ * record per access: a byte failed << 2 | op, then unsigned LEB128 varints
+ *
+ *   zigzag (address - address of the previous record), modulo 2^64, so that
+ *     any address round-trips, including those of failed accesses
+ *   the word read or written, zigzag encoded, for reads and writes; the
+ *     number of words for ranges, followed by every word for write ranges
+ *   nanoseconds since the previous record, if the flags have
+ *     ACCESS_TRACE_TIMESTAMPS
+ *
+ * so an access near the previous one with a small value takes 3 or 4 bytes.
+ */
+
+#define ACCESS_TRACE_VERSION 2
+#define ACCESS_TRACE_TIMESTAMPS 1
+
+enum access_op
+{
+  ACCESS_READ,
+  ACCESS_WRITE,
+  ACCESS_READ_RANGE,
+  ACCESS_WRITE_RANGE
+};
+
+struct access_record
+{
+  access_op op;
+  // the access returned 0
+  bool failed;
+  uint64_t address;
+  // the word read (0 if the read failed) or written, or the number of words
+  // of a range
+  uint64_t value;
+  // nanoseconds since recording started, 0 without timestamps
+  uint64_t time;
+};
+
+struct access_trace
+{
+  access_trace () : geometry (0, 0, 0), timestamps (false)
+  {}
+
+  MemoryGeometry geometry;
+  bool timestamps;
+  std::vector<access_record> records;
+  // the words of every write range, in the order of the records
+  std::vector<word_t> words;
+};
+
+/*
+ * appends records to a trace file through a buffer. record may be called
+ * from several threads at once in the concurrent build; the trace then has
+ * the accesses in the order they were recorded.
+ */
+class AccessTraceWriter
+{
+ public:
+  AccessTraceWriter ();
+  ~AccessTraceWriter ();
+
+  AccessTraceWriter (const AccessTraceWriter &) = delete;
+  AccessTraceWriter &operator= (const AccessTraceWriter &) = delete;
+
+  /*
+   * creates or truncates the file at path and writes the header.
+   * returns false if the file could not be created.
+   */
+  bool open (const char *path, const MemoryGeometry &geometry,
+             bool timestamps);
+
+  // words are the words written by a write range of value words
+  void record (access_op op, uint64_t address, uint64_t value, bool failed,
+               const word_t *words = NULL);
+
+  /*
+   * writes out the buffered records and closes the file.
+   * returns false if any part of the trace could not be written.
+   */
+  bool close ();
+
+ private:
+  void put_varint (uint64_t value);
+  void flush ();
+
+  Mutex lock;
+  FILE *file;
+  bool io_failed;
+  bool timestamps;
+  std::vector<uint8_t> buffer;
+  uint64_t previous_address;
+  std::chrono::steady_clock::time_point start;
+  uint64_t previous_time;
+};
+
+/*
+ * reads the trace at path into trace.
+ * returns false if the file cannot be read or is not a valid trace.
+ */
+bool read_access_trace (const char *path, access_trace *trace);
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef VM_CONCURRENT
+#include <atomic>
+#include <mutex>
+#include <pthread.h>
+#endif
+
+
+/*
+ * synchronization used when the library is built with VM_CONCURRENT. without
+ * it every lock below is empty and every shared access is a plain one, so
+ * the single threaded build is unchanged.
+ */
+
+/*
+ * a reader-writer lock. C++11 has no std::shared_mutex, so this wraps a
+ * pthread rwlock, preferring writers where the platform allows it so that a
+ * steady stream of readers cannot starve a faulting thread.
+ *
+ * the lock also keeps a sequence counter that is odd while it is held
+ * exclusively, so that readers can skip the lock altogether: anything read
+ * between readBegin and a successful readValidate was not changed by an
+ * exclusive holder. such reads have to go through loadShared.
+ */
+class RwLock {
+public:
+#ifdef VM_CONCURRENT
+    RwLock() : sequence_(0) {
+        pthread_rwlockattr_t attr;
+        pthread_rwlockattr_init(&attr);
+#ifdef __GLIBC__
+        pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+        pthread_rwlock_init(&lock_, &attr);
+        pthread_rwlockattr_destroy(&attr);
+    }
+
+    ~RwLock() {
+        pthread_rwlock_destroy(&lock_);
+    }
+
+    void lockShared() { pthread_rwlock_rdlock(&lock_); }
+    void unlockShared() { pthread_rwlock_unlock(&lock_); }
+
+    void lock() {
+        pthread_rwlock_wrlock(&lock_);
+        __atomic_store_n(&sequence_, sequence_ + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    void unlock() {
+        __atomic_store_n(&sequence_, sequence_ + 1, __ATOMIC_RELEASE);
+        pthread_rwlock_unlock(&lock_);
+    }
+
+    uint64_t readBegin() const {
+        return __atomic_load_n(&sequence_, __ATOMIC_ACQUIRE);
+    }
+
+    bool readValidate(uint64_t begin) const {
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return (begin & 1) == 0 && __atomic_load_n(&sequence_, __ATOMIC_RELAXED) == begin;
+    }
+#else
+    RwLock() {}
+
+    void lockShared() {}
+    void unlockShared() {}
+    void lock() {}
+    void unlock() {}
+
+    uint64_t readBegin() const { return 0; }
+    bool readValidate(uint64_t) const { return true; }
+#endif
+
+    RwLock(const RwLock&) = delete;
+    RwLock& operator=(const RwLock&) = delete;
+
+private:
+#ifdef VM_CONCURRENT
+    pthread_rwlock_t lock_;
+    uint64_t sequence_;
+#endif
+};
+
+/*
+ * holds an RwLock shared until upgrade() is called and exclusively after.
+ * in the single threaded build the holder always counts as exclusive.
+ */
+class RwLockGuard {
+public:
+    explicit RwLockGuard(RwLock& lock) : lock_(lock), exclusive_(false) {
+        lock_.lockShared();
+    }
+
+    ~RwLockGuard() {
+        if (exclusive_)
+            lock_.unlock();
+        else
+            lock_.unlockShared();
+    }
+
+    RwLockGuard(const RwLockGuard&) = delete;
+    RwLockGuard& operator=(const RwLockGuard&) = delete;
+
+#ifdef VM_CONCURRENT
+    bool exclusive() const { return exclusive_; }
+#else
+    bool exclusive() const { return true; }
+#endif
+
+    /*
+     * trades the shared hold for an exclusive one. the lock is released in
+     * between, so anything read under the shared hold has to be read again.
+     */
+    void upgrade() {
+        lock_.unlockShared();
+        lock_.lock();
+        exclusive_ = true;
+    }
+
+private:
+    RwLock& lock_;
+    bool exclusive_;
+};
+
+// a mutex for longer critical sections
+class Mutex {
+public:
+    Mutex() {}
+    Mutex(const Mutex&) = delete;
+    Mutex& operator=(const Mutex&) = delete;
+
+#ifdef VM_CONCURRENT
+    void lock() { mutex_.lock(); }
+    void unlock() { mutex_.unlock(); }
+
+private:
+    std::mutex mutex_;
+#else
+    void lock() {}
+    void unlock() {}
+#endif
+};
+
+// a spin lock for critical sections of a few instructions
+class SpinLock {
+public:
+    SpinLock() {
+#ifdef VM_CONCURRENT
+        flag_.clear();
+#endif
+    }
+
+    SpinLock(const SpinLock&) = delete;
+    SpinLock& operator=(const SpinLock&) = delete;
+
+#ifdef VM_CONCURRENT
+    void lock() {
+        while (flag_.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+
+    void unlock() { flag_.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag flag_;
+#else
+    void lock() {}
+    void unlock() {}
+#endif
+};
+
+/*
+ * accesses to words that one thread may write while others read them
+ * without holding a common lock, such as page table entries. a store
+ * publishes everything written before it to the threads that load the value.
+ */
+template <class T>
+inline T loadShared(const T* location) {
+#ifdef VM_CONCURRENT
+    return __atomic_load_n(location, __ATOMIC_ACQUIRE);
+#else
+    return *location;
+#endif
+}
+
+template <class T>
+inline void storeShared(T* location, T value) {
+#ifdef VM_CONCURRENT
+    __atomic_store_n(location, value, __ATOMIC_RELEASE);
+#else
+    *location = value;
+#endif
+}
+
+// bulk versions of storeShared, without ordering between the words
+template <class T>
+inline void copyShared(T* destination, const T* source, size_t count) {
+#ifdef VM_CONCURRENT
+    for (size_t i = 0; i < count; ++i)
+        __atomic_store_n(destination + i, source[i], __ATOMIC_RELAXED);
+#else
+    std::copy(source, source + count, destination);
+#endif
+}
+
+template <class T>
+inline void fillShared(T* destination, T value, size_t count) {
+#ifdef VM_CONCURRENT
+    for (size_t i = 0; i < count; ++i)
+        __atomic_store_n(destination + i, value, __ATOMIC_RELAXED);
+#else
+    std::fill(destination, destination + count, value);
+#endif
+}
+
+// increments a counter that several threads may bump at once and returns
+// its new value
+inline uint64_t incrementShared(uint64_t* counter) {
+#ifdef VM_CONCURRENT
+    return __atomic_add_fetch(counter, 1, __ATOMIC_RELAXED);
+#else
+    return ++*counter;
+#endif
+}
+
+// adds to an event counter that several threads may bump at once
+inline void countEvent(uint64_t* counter, uint64_t amount = 1) {
+#ifdef VM_CONCURRENT
+    __atomic_fetch_add(counter, amount, __ATOMIC_RELAXED);
+#else
+    *counter += amount;
+#endif
+}
+
+inline uint64_t loadCounter(const uint64_t* counter) {
+#ifdef VM_CONCURRENT
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+#else
+    return *counter;
+#endif
+}
@@ -2,6 +2,7 @@
 
 #include <climits>
 #include <stdint.h>
+#include "MemoryGeometry.h"
 
 
 
@@ -51,9 +52,6 @@
 
 /* ----------- common to all constant configurations -------------- */
 
-// word
-typedef int word_t;
-
 // number of bits in a word
 #define WORD_WIDTH (sizeof(word_t) * CHAR_BIT)
 
@@ -76,5 +74,5 @@ typedef int word_t;
 // number of pages in the virtual memory
 #define NUM_PAGES (VIRTUAL_MEMORY_SIZE / PAGE_SIZE)
 
-#define CEIL(VARIABLE) ( (VARIABLE - (int)VARIABLE)==0 ? (int)VARIABLE : (int)VARIABLE+1 )
-#define TABLES_DEPTH CEIL((((VIRTUAL_ADDRESS_WIDTH - OFFSET_WIDTH) / (double)OFFSET_WIDTH)))
+// ceil((VIRTUAL_ADDRESS_WIDTH - OFFSET_WIDTH) / OFFSET_WIDTH) in integers
+#define TABLES_DEPTH ((VIRTUAL_ADDRESS_WIDTH - 1) / OFFSET_WIDTH)
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h>
+
+// word
+typedef int word_t;
+
+/*
+ * the geometry of a virtual memory, computed at runtime from the three
+ * widths that MemoryConstants.h fixes at compile time.
+ */
+struct MemoryGeometry {
+    MemoryGeometry(int offsetWidth, int physicalAddressWidth, int virtualAddressWidth)
+            : offsetWidth(offsetWidth),
+              physicalAddressWidth(physicalAddressWidth),
+              virtualAddressWidth(virtualAddressWidth),
+              pageSize(1ull << offsetWidth),
+              ramSize(1ull << physicalAddressWidth),
+              virtualMemorySize(1ull << virtualAddressWidth),
+              numFrames(ramSize / pageSize),
+              numPages(virtualMemorySize / pageSize),
+              tablesDepth(offsetWidth > 0 ? (virtualAddressWidth - 1) / offsetWidth : 0) {
+    }
+
+    /*
+     * returns true if the widths describe a memory that can be simulated
+     */
+    bool isValid() const {
+        return offsetWidth > 0 && offsetWidth <= physicalAddressWidth
+               && offsetWidth <= virtualAddressWidth
+               && physicalAddressWidth < 48 && virtualAddressWidth < 48;
+    }
+
+    // number of bits in the offset, page/frame size in words and number of
+    // entries in a table
+    int offsetWidth;
+    int physicalAddressWidth;
+    int virtualAddressWidth;
+
+    uint64_t pageSize;
+    uint64_t ramSize;
+    uint64_t virtualMemorySize;
+    uint64_t numFrames;
+    uint64_t numPages;
+
+    // number of table levels above the pages, ceil((V - O) / O)
+    int tablesDepth;
+};
+
+/*
+ * the same geometry fixed at compile time. every quantity is an integer
+ * constant expression, so code templated on a FixedGeometry folds all page
+ * sizes, shifts, masks and the table depth.
+ */
+template <int OffsetWidth, int PhysicalAddressWidth, int VirtualAddressWidth>
+struct FixedGeometry {
+    FixedGeometry() {
+    }
+
+    explicit FixedGeometry(const MemoryGeometry&) {
+    }
+
+    static constexpr bool isValid() {
+        return OffsetWidth > 0 && OffsetWidth <= PhysicalAddressWidth
+               && OffsetWidth <= VirtualAddressWidth
+               && PhysicalAddressWidth < 48 && VirtualAddressWidth < 48;
+    }
+
+    static constexpr int offsetWidth = OffsetWidth;
+    static constexpr int physicalAddressWidth = PhysicalAddressWidth;
+    static constexpr int virtualAddressWidth = VirtualAddressWidth;
+
+    static constexpr uint64_t pageSize = 1ull << OffsetWidth;
+    static constexpr uint64_t ramSize = 1ull << PhysicalAddressWidth;
+    static constexpr uint64_t virtualMemorySize = 1ull << VirtualAddressWidth;
+    static constexpr uint64_t numFrames = ramSize / pageSize;
+    static constexpr uint64_t numPages = virtualMemorySize / pageSize;
+
+    static constexpr int tablesDepth = (VirtualAddressWidth - 1) / OffsetWidth;
+};
+
+template <int O, int P, int V> constexpr int FixedGeometry<O, P, V>::offsetWidth;
+template <int O, int P, int V> constexpr int FixedGeometry<O, P, V>::physicalAddressWidth;
+template <int O, int P, int V> constexpr int FixedGeometry<O, P, V>::virtualAddressWidth;
+template <int O, int P, int V> constexpr uint64_t FixedGeometry<O, P, V>::pageSize;
+template <int O, int P, int V> constexpr uint64_t FixedGeometry<O, P, V>::ramSize;
+template <int O, int P, int V> constexpr uint64_t FixedGeometry<O, P, V>::virtualMemorySize;
+template <int O, int P, int V> constexpr uint64_t FixedGeometry<O, P, V>::numFrames;
+template <int O, int P, int V> constexpr uint64_t FixedGeometry<O, P, V>::numPages;
+template <int O, int P, int V> constexpr int FixedGeometry<O, P, V>::tablesDepth;
@@ -1,44 +1,35 @@
 #pragma once
 
 #include "MemoryConstants.h"
+#include "PhysicalMemoryInstance.h"
 #include <random>
 
-#ifdef INC_TESTING_CODE
 
-#include <memory>
-#include <sstream>
-
-
-class Trace {
-    static std::unique_ptr<std::stringstream> ss;
-
-public:
-
-    Trace() {
-        ss->clear();
-    }
-
-    inline static std::stringstream& stream() {
-        return *ss;
-    }
-
-    inline std::string GetContents() {
-        return ss->str();
-    }
-};
-
-
-#endif
+/*
+ * the physical memory used by the functions below and by the VM* functions,
+ * sized by the constants in MemoryConstants.h
+ */
+PhysicalMemory& defaultPhysicalMemory();
 
 /*
  * reads an integer from the given physical address and puts it in 'value'
  */
-void PMread(uint64_t physicalAddress, word_t* value);
+inline void PMread(uint64_t physicalAddress, word_t* value) {
+    defaultPhysicalMemory().read(physicalAddress, value);
+}
 
 /*
  * writes 'value' to the given physical address
  */
-void PMwrite(uint64_t physicalAddress, word_t value);
+inline void PMwrite(uint64_t physicalAddress, word_t value) {
+    defaultPhysicalMemory().write(physicalAddress, value);
+}
+
+
+/*
+ * sets all the words of the given frame to 0 in constant time
+ */
+void PMzeroFrame(uint64_t frameIndex);
 
 
 /*
@@ -51,3 +42,22 @@ void PMevict(uint64_t frameIndex, uint64_t evictedPageIndex);
  * restores a page from the hard drive to the RAM
  */
 void PMrestore(uint64_t frameIndex, uint64_t restoredPageIndex);
+
+
+/*
+ * selects the swap backend used by PMevict and PMrestore and discards all
+ * pages currently in swap. with a NULL path evicted pages are kept in process
+ * memory; otherwise they are stored in the given file, which is created or
+ * truncated and mapped with mmap, one page sized slot per virtual page.
+ *
+ * returns 1 on success.
+ * returns 0 if the file could not be created or mapped, in which case the
+ * in-memory backend is used.
+ */
+int PMsetSwapFile(const char* path);
+
+
+/*
+ * discards all pages currently in swap, keeping the selected backend
+ */
+void PMclearSwap();
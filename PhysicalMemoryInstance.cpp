@@ -0,0 +1,183 @@
+#include "PhysicalMemoryInstance.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fcntl.h>
+#include <mutex>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+#define RAM_ALIGNMENT 4096
+#define SWAP_SLAB_SHIFT 6
+#define SWAP_SLAB_PAGES (1u << SWAP_SLAB_SHIFT)
+
+
+PhysicalMemory::PhysicalMemory(const MemoryGeometry& geometry)
+        : geometry_(geometry),
+          ram_(NULL),
+          zeroFrames_(geometry.numFrames, 0),
+          swapSlots_(geometry.numPages),
+          swapPresent_((geometry.numPages + 63) / 64, 0),
+          swapMapping_(NULL),
+          swapMappingBytes_(0) {
+    assert(geometry.isValid());
+
+    void* ram = NULL;
+    size_t bytes = std::max<size_t>(geometry.ramSize * sizeof(word_t), RAM_ALIGNMENT);
+    if (posix_memalign(&ram, RAM_ALIGNMENT, bytes) != 0)
+        throw std::bad_alloc();
+    ram_ = static_cast<word_t*>(ram);
+    std::fill(ram_, ram_ + geometry.ramSize, 0);
+    resetAccessCounts();
+}
+
+PhysicalMemory::~PhysicalMemory() {
+    unmapSwapFile();
+    free(ram_);
+}
+
+void PhysicalMemory::materializeFrame(uint64_t frameIndex) {
+    fillShared(frameBase(frameIndex), word_t(0), geometry_.pageSize);
+    storeShared(&zeroFrames_[frameIndex], uint8_t(0));
+}
+
+void PhysicalMemory::setSwapped(uint64_t pageIndex, bool swapped) {
+    if (swapped)
+        swapPresent_[pageIndex / 64] |= 1ull << (pageIndex % 64);
+    else
+        swapPresent_[pageIndex / 64] &= ~(1ull << (pageIndex % 64));
+}
+
+word_t* PhysicalMemory::swapSlot(uint64_t pageIndex) {
+    if (swapMapping_ != NULL)
+        return swapMapping_ + (pageIndex << geometry_.offsetWidth);
+
+    uint32_t slot = swapSlots_[pageIndex];
+    return swapSlabs_[slot >> SWAP_SLAB_SHIFT].get()
+           + ((uint64_t) (slot & (SWAP_SLAB_PAGES - 1)) << geometry_.offsetWidth);
+}
+
+uint32_t PhysicalMemory::allocateSwapSlot() {
+    if (freeSwapSlots_.empty()) {
+        uint32_t first = swapSlabs_.size() * SWAP_SLAB_PAGES;
+        swapSlabs_.push_back(std::unique_ptr<word_t[]>(new word_t[SWAP_SLAB_PAGES * geometry_.pageSize]));
+        freeSwapSlots_.reserve(swapSlabs_.size() * SWAP_SLAB_PAGES);
+        for (uint32_t slot = first + SWAP_SLAB_PAGES; slot > first; --slot)
+            freeSwapSlots_.push_back(slot - 1);
+    }
+    uint32_t slot = freeSwapSlots_.back();
+    freeSwapSlots_.pop_back();
+    return slot;
+}
+
+void PhysicalMemory::unmapSwapFile() {
+    if (swapMapping_ != NULL) {
+        munmap(swapMapping_, swapMappingBytes_);
+        swapMapping_ = NULL;
+    }
+}
+
+void PhysicalMemory::clearSwap() {
+    std::fill(swapPresent_.begin(), swapPresent_.end(), 0);
+    freeSwapSlots_.clear();
+    for (uint32_t slot = swapSlabs_.size() * SWAP_SLAB_PAGES; slot > 0; --slot)
+        freeSwapSlots_.push_back(slot - 1);
+}
+
+int PhysicalMemory::setSwapFile(const char* path) {
+    clearSwap();
+    unmapSwapFile();
+    if (path == NULL)
+        return 1;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        return 0;
+
+    size_t bytes = geometry_.numPages * geometry_.pageSize * sizeof(word_t);
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, bytes) == 0)
+        mapping = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return 0;
+
+    swapMapping_ = static_cast<word_t*>(mapping);
+    swapMappingBytes_ = bytes;
+    return 1;
+}
+
+void PhysicalMemory::zeroFrame(uint64_t frameIndex) {
+#ifdef INC_TESTING_CODE
+    Trace::record(TRACE_PM_ZERO_FRAME, frameIndex);
+#endif
+
+    assert(frameIndex < geometry_.numFrames);
+
+    storeShared(&zeroFrames_[frameIndex], uint8_t(1));
+}
+
+bool PhysicalMemory::evict(uint64_t frameIndex, uint64_t evictedPageIndex, bool dirty) {
+#ifdef INC_TESTING_CODE
+    Trace::record(TRACE_PM_EVICT, frameIndex, evictedPageIndex);
+#endif
+
+    assert(frameIndex < geometry_.numFrames);
+    assert(evictedPageIndex < geometry_.numPages);
+
+    std::lock_guard<Mutex> hold(swapLock_);
+    if (isSwapped(evictedPageIndex) && !dirty)
+        return false;
+
+    if (!isSwapped(evictedPageIndex) && swapMapping_ == NULL)
+        swapSlots_[evictedPageIndex] = allocateSwapSlot();
+    if (zeroFrames_[frameIndex])
+        materializeFrame(frameIndex);
+    std::copy(frameBase(frameIndex), frameBase(frameIndex) + geometry_.pageSize,
+              swapSlot(evictedPageIndex));
+    setSwapped(evictedPageIndex, true);
+    return true;
+}
+
+void PhysicalMemory::restore(uint64_t frameIndex, uint64_t restoredPageIndex) {
+#ifdef INC_TESTING_CODE
+    Trace::record(TRACE_PM_RESTORE, frameIndex, restoredPageIndex);
+#endif
+
+    assert(frameIndex < geometry_.numFrames);
+
+    std::lock_guard<Mutex> hold(swapLock_);
+    // page is not in swap file, so this is essentially
+    // the first reference to this page. we can just return
+    // as it doesn't matter if the page contains garbage
+    if (!isSwapped(restoredPageIndex)) {
+        return;
+    }
+
+    storeShared(&zeroFrames_[frameIndex], uint8_t(0));
+    word_t* slot = swapSlot(restoredPageIndex);
+    copyShared(frameBase(frameIndex), slot, geometry_.pageSize);
+}
+
+uint64_t PhysicalMemory::readCount() const {
+    uint64_t reads = 0;
+    for (int i = 0; i < PM_COUNTER_SHARDS; ++i)
+        reads += loadCounter(&counters_[i].reads);
+    return reads;
+}
+
+uint64_t PhysicalMemory::writeCount() const {
+    uint64_t writes = 0;
+    for (int i = 0; i < PM_COUNTER_SHARDS; ++i)
+        writes += loadCounter(&counters_[i].writes);
+    return writes;
+}
+
+void PhysicalMemory::resetAccessCounts() {
+    for (int i = 0; i < PM_COUNTER_SHARDS; ++i) {
+        storeShared(&counters_[i].reads, uint64_t(0));
+        storeShared(&counters_[i].writes, uint64_t(0));
+    }
+}
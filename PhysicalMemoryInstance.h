@@ -0,0 +1,180 @@
+#pragma once
+
+#include "Locks.h"
+#include "MemoryGeometry.h"
+#include "Trace.h"
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// the read and write counts are split over this many cache lines by frame, a
+// power of two, so that threads on different frames rarely share one
+#define PM_COUNTER_SHARDS 16
+
+
+/*
+ * a simulated physical memory of a given geometry together with its swap.
+ *
+ * RAM is one contiguous page aligned block of ramSize words and a physical
+ * address is simply an index into it. evicted pages are kept either in
+ * process memory or in a memory mapped swap file, see setSwapFile.
+ */
+class PhysicalMemory {
+public:
+    /*
+     * throws std::bad_alloc if the RAM or the state of its frames and of the
+     * swap cannot be allocated, see create_virtual_memory
+     */
+    explicit PhysicalMemory(const MemoryGeometry& geometry);
+    ~PhysicalMemory();
+
+    PhysicalMemory(const PhysicalMemory&) = delete;
+    PhysicalMemory& operator=(const PhysicalMemory&) = delete;
+
+    const MemoryGeometry& geometry() const {
+        return geometry_;
+    }
+
+    /*
+     * reads an integer from the given physical address and puts it in 'value'
+     */
+    inline void read(uint64_t physicalAddress, word_t* value) {
+        assert(physicalAddress < geometry_.ramSize);
+        countEvent(&counterShard(physicalAddress).reads);
+
+        *value = loadShared(&zeroFrames_[physicalAddress >> geometry_.offsetWidth])
+                 ? 0 : loadShared(&ram_[physicalAddress]);
+
+#ifdef INC_TESTING_CODE
+        Trace::record(TRACE_PM_READ, physicalAddress, (uint64_t) *value);
+#endif
+    }
+
+    /*
+     * writes 'value' to the given physical address
+     */
+    inline void write(uint64_t physicalAddress, word_t value) {
+#ifdef INC_TESTING_CODE
+        Trace::record(TRACE_PM_WRITE, physicalAddress, (uint64_t) value);
+#endif
+
+        assert(physicalAddress < geometry_.ramSize);
+        countEvent(&counterShard(physicalAddress).writes);
+
+        if (zeroFrames_[physicalAddress >> geometry_.offsetWidth])
+            materializeFrame(physicalAddress >> geometry_.offsetWidth);
+        storeShared(&ram_[physicalAddress], value);
+    }
+
+    /*
+     * clears the words of a frame marked by zeroFrame right away, so that
+     * later writes to it do not have to. concurrent writers of one frame rely
+     * on this, as two of them could otherwise both clear it.
+     */
+    inline void materialize(uint64_t frameIndex) {
+        if (zeroFrames_[frameIndex])
+            materializeFrame(frameIndex);
+    }
+
+    /*
+     * sets all the words of the given frame to 0 in constant time. the frame
+     * is only marked, reads from it return 0 and the first write clears it.
+     */
+    void zeroFrame(uint64_t frameIndex);
+
+    /*
+     * evicts a page from the RAM to the hard drive. a page that is not dirty,
+     * i.e. was not written since it was restored, still has its copy in swap
+     * and is not written again.
+     *
+     * returns true if the frame was copied to swap.
+     *
+     * evict and restore may be called concurrently for different pages.
+     */
+    bool evict(uint64_t frameIndex, uint64_t evictedPageIndex, bool dirty = true);
+
+    /*
+     * restores a page from the hard drive to the RAM. the copy in swap is
+     * kept, so that the page can be evicted again without writing it back
+     * as long as it stays clean.
+     */
+    void restore(uint64_t frameIndex, uint64_t restoredPageIndex);
+
+    /*
+     * selects the swap backend and discards all pages currently in swap. with
+     * a NULL path evicted pages are kept in process memory; otherwise they are
+     * stored in the given file, which is created or truncated and mapped with
+     * mmap, one page sized slot per virtual page.
+     *
+     * returns 1 on success.
+     * returns 0 if the file could not be created or mapped, in which case the
+     * in-memory backend is used.
+     */
+    int setSwapFile(const char* path);
+
+    /*
+     * discards all pages currently in swap, keeping the selected backend
+     */
+    void clearSwap();
+
+    /*
+     * the number of read and write calls since the last resetAccessCounts
+     */
+    uint64_t readCount() const;
+    uint64_t writeCount() const;
+    void resetAccessCounts();
+
+private:
+    struct CounterShard {
+        uint64_t reads;
+        uint64_t writes;
+        char padding[64 - 2 * sizeof(uint64_t)];
+    };
+
+    inline CounterShard& counterShard(uint64_t physicalAddress) {
+        return counters_[(physicalAddress >> geometry_.offsetWidth) & (PM_COUNTER_SHARDS - 1)];
+    }
+
+    inline word_t* frameBase(uint64_t frameIndex) {
+        return ram_ + (frameIndex << geometry_.offsetWidth);
+    }
+
+    inline bool isSwapped(uint64_t pageIndex) const {
+        return (swapPresent_[pageIndex / 64] >> (pageIndex % 64)) & 1;
+    }
+
+    void materializeFrame(uint64_t frameIndex);
+    void setSwapped(uint64_t pageIndex, bool swapped);
+    word_t* swapSlot(uint64_t pageIndex);
+    uint32_t allocateSwapSlot();
+    void unmapSwapFile();
+
+    MemoryGeometry geometry_;
+
+    word_t* ram_;
+    // frames that are logically zero but whose words in RAM were not cleared
+    std::vector<uint8_t> zeroFrames_;
+
+    // swapped out pages live in page sized buffers handed out from slabs.
+    // swapSlots_ maps every swapped page to its buffer and swapPresent_ has a
+    // bit set for every page that has a copy in swap, including the pages
+    // restored since. buffers are released by clearSwap and recycled through
+    // freeSwapSlots_, so steady state eviction and restoration never
+    // allocate.
+    std::vector<uint32_t> swapSlots_;
+    std::vector<uint64_t> swapPresent_;
+    std::vector<std::unique_ptr<word_t[]> > swapSlabs_;
+    std::vector<uint32_t> freeSwapSlots_;
+
+    // serializes evict and restore, which share the swap metadata above
+    Mutex swapLock_;
+
+    // mmap swap backend, used when swapMapping_ is not NULL. page i is stored
+    // in slot i of the mapping instead of a slab buffer
+    word_t* swapMapping_;
+    size_t swapMappingBytes_;
+
+    CounterShard counters_[PM_COUNTER_SHARDS];
+};
@@ -0,0 +1,450 @@
+#include "ReplacementPolicy.h"
+#include "Locks.h"
+
+#include <algorithm>
+#include <vector>
+
+#define BITMAP_WORDS(BITS) (((BITS) + 63) / 64)
+#define NO_PAGE (~0ull)
+#define NO_FRAME 0
+
+namespace
+{
+
+uint64_t cyclic_distance (uint64_t in_page, uint64_t ref_page,
+                          uint64_t num_pages)
+{
+  uint64_t abs_diff = in_page > ref_page ? in_page - ref_page
+                                         : ref_page - in_page;
+  if (num_pages - abs_diff < abs_diff)
+  {
+    return num_pages - abs_diff;
+  }
+  return abs_diff;
+}
+
+/*
+ * evicts the page at maximal cyclic distance from the faulting page,
+ * preferring the lowest page number on ties.
+ */
+class CyclicDistancePolicy : public ReplacementPolicy
+{
+ public:
+  void reset (uint64_t num_frames, uint64_t num_pages) override
+  {
+    (void) num_frames;
+    this->num_pages = num_pages;
+    resident_index.clear ();
+    uint64_t bits = num_pages;
+    do
+    {
+      resident_index.push_back (std::vector<uint64_t> (BITMAP_WORDS (bits),
+                                                       0));
+      bits = BITMAP_WORDS (bits);
+    }
+    while (bits > 1);
+    resident_frame.assign (num_pages, NO_FRAME);
+  }
+
+  void on_map (uint64_t page, word_t frame) override
+  {
+    resident_frame[page] = frame;
+    uint64_t pos = page;
+    for (size_t level = 0; level < resident_index.size (); ++level)
+    {
+      uint64_t *word = &resident_index[level][pos / 64];
+      bool was_empty = *word == 0;
+      *word |= 1ull << (pos % 64);
+      if (!was_empty) return;
+      pos /= 64;
+    }
+  }
+
+  void on_unmap (uint64_t page, word_t frame) override
+  {
+    (void) frame;
+    uint64_t pos = page;
+    for (size_t level = 0; level < resident_index.size (); ++level)
+    {
+      uint64_t *word = &resident_index[level][pos / 64];
+      *word &= ~(1ull << (pos % 64));
+      if (*word != 0) return;
+      pos /= 64;
+    }
+  }
+
+  // the farthest pages are the resident pages closest to the antipode of
+  // page, so only the nearest resident page on each side of it has to be
+  // considered
+  word_t choose_victim (uint64_t page) override
+  {
+    uint64_t antipode = (page + num_pages / 2) % num_pages;
+    uint64_t after = index_next (0, antipode);
+    if (after == NO_PAGE) after = index_next (0, 0);
+    uint64_t before = index_prev (0, antipode);
+    if (before == NO_PAGE) before = index_prev (0, num_pages - 1);
+    if (after == NO_PAGE) return NO_FRAME;
+
+    uint64_t after_dist = cyclic_distance (page, after, num_pages);
+    uint64_t before_dist = cyclic_distance (page, before, num_pages);
+    if (before_dist > after_dist || (before_dist == after_dist
+                                     && before < after))
+    {
+      return resident_frame[before];
+    }
+    return resident_frame[after];
+  }
+
+ private:
+  // returns the lowest set position >= pos in the given level, or NO_PAGE
+  uint64_t index_next (int level, uint64_t pos) const
+  {
+    const std::vector<uint64_t> &words = resident_index[level];
+    uint64_t word = pos / 64;
+    if (word >= words.size ()) return NO_PAGE;
+
+    uint64_t bits = words[word] & (~0ull << (pos % 64));
+    if (bits != 0) return word * 64 + __builtin_ctzll (bits);
+    if ((size_t) level + 1 == resident_index.size ()) return NO_PAGE;
+
+    word = index_next (level + 1, word + 1);
+    if (word == NO_PAGE) return NO_PAGE;
+    return word * 64 + __builtin_ctzll (words[word]);
+  }
+
+  // returns the highest set position <= pos in the given level, or NO_PAGE
+  uint64_t index_prev (int level, uint64_t pos) const
+  {
+    if (pos == NO_PAGE) return NO_PAGE;
+    const std::vector<uint64_t> &words = resident_index[level];
+    uint64_t word = pos / 64;
+
+    uint64_t bits = words[word] & (~0ull >> (63 - pos % 64));
+    if (bits != 0) return word * 64 + 63 - __builtin_clzll (bits);
+    if ((size_t) level + 1 == resident_index.size () || word == 0)
+      return NO_PAGE;
+
+    word = index_prev (level + 1, word - 1);
+    if (word == NO_PAGE) return NO_PAGE;
+    return word * 64 + 63 - __builtin_clzll (words[word]);
+  }
+
+  uint64_t num_pages;
+
+  // resident page index: a 64-ary hierarchy of bitmaps over page numbers,
+  // level 0 holds one bit per page and every level above summarizes the
+  // non-zero words of the level below, up to a single word
+  std::vector<std::vector<uint64_t> > resident_index;
+  std::vector<word_t> resident_frame;
+};
+
+/*
+ * evicts the page with the oldest stamp. pages are stamped when they are
+ * mapped and, for LRU, whenever they are referenced; without the latter
+ * this is FIFO. the victim is found by a scan over the frames.
+ */
+class StampPolicy : public ReplacementPolicy
+{
+ public:
+  explicit StampPolicy (bool stamp_accesses)
+      : stamp_accesses (stamp_accesses), clock (0)
+  {}
+
+  void reset (uint64_t num_frames, uint64_t num_pages) override
+  {
+    (void) num_pages;
+    page_of_frame.assign (num_frames, NO_PAGE);
+    stamps.assign (num_frames, 0);
+    clock = 0;
+  }
+
+  void on_map (uint64_t page, word_t frame) override
+  {
+    page_of_frame[frame] = page;
+    storeShared (&stamps[frame], incrementShared (&clock));
+  }
+
+  void on_unmap (uint64_t page, word_t frame) override
+  {
+    (void) page;
+    page_of_frame[frame] = NO_PAGE;
+  }
+
+  bool tracks_accesses () const override
+  { return stamp_accesses; }
+
+  void on_access (uint64_t page, word_t frame) override
+  {
+    (void) page;
+    storeShared (&stamps[frame], incrementShared (&clock));
+  }
+
+  word_t choose_victim (uint64_t page) override
+  {
+    (void) page;
+    word_t victim = NO_FRAME;
+    uint64_t oldest = 0;
+    for (size_t frame = 0; frame < page_of_frame.size (); ++frame)
+    {
+      if (page_of_frame[frame] == NO_PAGE) continue;
+      uint64_t stamp = loadShared (&stamps[frame]);
+      if (victim == NO_FRAME || stamp < oldest)
+      {
+        victim = (word_t) frame;
+        oldest = stamp;
+      }
+    }
+    return victim;
+  }
+
+ private:
+  bool stamp_accesses;
+  uint64_t clock;
+  std::vector<uint64_t> page_of_frame;
+  std::vector<uint64_t> stamps;
+};
+
+/*
+ * second chance: a hand sweeps the frames and evicts the first page that
+ * was not referenced since the hand last passed it, clearing the referenced
+ * bits of the pages it spares.
+ */
+class ClockPolicy : public ReplacementPolicy
+{
+ public:
+  ClockPolicy () : hand (0)
+  {}
+
+  void reset (uint64_t num_frames, uint64_t num_pages) override
+  {
+    (void) num_pages;
+    page_of_frame.assign (num_frames, NO_PAGE);
+    referenced.assign (num_frames, 0);
+    hand = 0;
+  }
+
+  void on_map (uint64_t page, word_t frame) override
+  {
+    page_of_frame[frame] = page;
+    storeShared (&referenced[frame], uint8_t (1));
+  }
+
+  void on_unmap (uint64_t page, word_t frame) override
+  {
+    (void) page;
+    page_of_frame[frame] = NO_PAGE;
+  }
+
+  bool tracks_accesses () const override
+  { return true; }
+
+  void on_access (uint64_t page, word_t frame) override
+  {
+    (void) page;
+    // avoid dirtying the line when the bit is already set
+    if (!loadShared (&referenced[frame]))
+      storeShared (&referenced[frame], uint8_t (1));
+  }
+
+  word_t choose_victim (uint64_t page) override
+  {
+    (void) page;
+    // two sweeps clear every bit, unless other threads keep setting them
+    size_t frames = page_of_frame.size ();
+    for (size_t step = 0; step < 2 * frames; ++step)
+    {
+      size_t frame = hand;
+      hand = (hand + 1) % frames;
+      if (page_of_frame[frame] == NO_PAGE) continue;
+      if (!loadShared (&referenced[frame])) return (word_t) frame;
+      storeShared (&referenced[frame], uint8_t (0));
+    }
+    for (size_t frame = 0; frame < frames; ++frame)
+    {
+      if (page_of_frame[frame] != NO_PAGE) return (word_t) frame;
+    }
+    return NO_FRAME;
+  }
+
+ private:
+  size_t hand;
+  std::vector<uint64_t> page_of_frame;
+  std::vector<uint8_t> referenced;
+};
+
+/*
+ * CAR (Bansal and Modha, "CAR: Clock with Adaptive Replacement"). resident
+ * pages are kept in two clocks, T1 for pages referenced once since they were
+ * mapped and T2 for pages referenced again, together with the ghost lists B1
+ * and B2 of pages recently evicted from each. a fault on a ghost page shifts
+ * the target size p of T1 towards the list it was evicted from, so the split
+ * between recency and frequency adapts to the workload, and a scan only
+ * churns T1.
+ *
+ * the number of frames available to pages changes as tables come and go, so
+ * the cache size c is taken to be the number of resident pages.
+ */
+class CarPolicy : public ReplacementPolicy
+{
+ public:
+  CarPolicy () : target (0)
+  {}
+
+  void reset (uint64_t num_frames, uint64_t num_pages) override
+  {
+    prev.assign (num_pages, NO_PAGE);
+    next.assign (num_pages, NO_PAGE);
+    where.assign (num_pages, NOWHERE);
+    frame_of_page.assign (num_pages, NO_FRAME);
+    referenced.assign (num_frames, 0);
+    for (int list = 0; list < LISTS; ++list)
+    {
+      lists[list].head = lists[list].tail = NO_PAGE;
+      lists[list].size = 0;
+    }
+    target = 0;
+  }
+
+  void on_map (uint64_t page, word_t frame) override
+  {
+    uint64_t cache_size = lists[T1].size + lists[T2].size + 1;
+    if (where[page] == B1)
+    {
+      target += std::max<uint64_t> (1, lists[B2].size / lists[B1].size);
+      target = std::min (target, cache_size);
+      move_to (T2, page);
+    }
+    else if (where[page] == B2)
+    {
+      uint64_t step = std::max<uint64_t> (1, lists[B1].size
+                                             / lists[B2].size);
+      target = target > step ? target - step : 0;
+      move_to (T2, page);
+    }
+    else
+    {
+      // a new page: keep the directory within ARC's bounds of c pages in
+      // T1 and B1 and 2c pages overall
+      while (lists[T1].size + lists[B1].size >= cache_size
+             && lists[B1].size > 0)
+        move_to (NOWHERE, lists[B1].head);
+      while (lists[T1].size + lists[T2].size + lists[B1].size
+             + lists[B2].size >= 2 * cache_size && lists[B2].size > 0)
+        move_to (NOWHERE, lists[B2].head);
+      move_to (T1, page);
+    }
+    frame_of_page[page] = frame;
+    storeShared (&referenced[frame], uint8_t (0));
+  }
+
+  void on_unmap (uint64_t page, word_t frame) override
+  {
+    (void) frame;
+    if (where[page] == T1)
+      move_to (B1, page);
+    else if (where[page] == T2)
+      move_to (B2, page);
+  }
+
+  bool tracks_accesses () const override
+  { return true; }
+
+  void on_access (uint64_t page, word_t frame) override
+  {
+    (void) page;
+    if (!loadShared (&referenced[frame]))
+      storeShared (&referenced[frame], uint8_t (1));
+  }
+
+  word_t choose_victim (uint64_t page) override
+  {
+    (void) page;
+    uint64_t resident = lists[T1].size + lists[T2].size;
+    if (resident == 0) return NO_FRAME;
+
+    // every step clears a bit, so this ends within two passes unless other
+    // threads keep setting them
+    for (uint64_t step = 0; step <= 2 * resident; ++step)
+    {
+      int list = lists[T1].size >= std::max<uint64_t> (1, target)
+                 || lists[T2].size == 0 ? T1 : T2;
+      uint64_t head = lists[list].head;
+      word_t frame = frame_of_page[head];
+      if (!loadShared (&referenced[frame])) return frame;
+      storeShared (&referenced[frame], uint8_t (0));
+      move_to (T2, head);
+    }
+    return frame_of_page[lists[T1].size > 0 ? lists[T1].head
+                                           : lists[T2].head];
+  }
+
+ private:
+  enum
+  {
+      NOWHERE, T1, T2, B1, B2, LISTS
+  };
+
+  struct page_list
+  {
+      uint64_t head;
+      uint64_t tail;
+      uint64_t size;
+  };
+
+  // moves page from its current list to the tail of list
+  void move_to (int list, uint64_t page)
+  {
+    int from = where[page];
+    if (from != NOWHERE)
+    {
+      page_list &old = lists[from];
+      if (prev[page] != NO_PAGE) next[prev[page]] = next[page];
+      else old.head = next[page];
+      if (next[page] != NO_PAGE) prev[next[page]] = prev[page];
+      else old.tail = prev[page];
+      old.size--;
+    }
+
+    where[page] = (uint8_t) list;
+    prev[page] = next[page] = NO_PAGE;
+    if (list == NOWHERE) return;
+
+    page_list &to = lists[list];
+    prev[page] = to.tail;
+    if (to.tail != NO_PAGE) next[to.tail] = page;
+    else to.head = page;
+    to.tail = page;
+    to.size++;
+  }
+
+  // the lists are threaded through prev and next, indexed by page. clock
+  // hands are the heads of T1 and T2, the ghost lists are LRU at the head.
+  std::vector<uint64_t> prev;
+  std::vector<uint64_t> next;
+  std::vector<uint8_t> where;
+  std::vector<word_t> frame_of_page;
+  std::vector<uint8_t> referenced;
+  page_list lists[LISTS];
+  uint64_t target;
+};
+
+}
+
+std::unique_ptr<ReplacementPolicy>
+create_replacement_policy (VMReplacementPolicy kind)
+{
+  switch (kind)
+  {
+    case VM_POLICY_CYCLIC_DISTANCE:
+      return std::unique_ptr<ReplacementPolicy> (new CyclicDistancePolicy ());
+    case VM_POLICY_LRU:
+      return std::unique_ptr<ReplacementPolicy> (new StampPolicy (true));
+    case VM_POLICY_CLOCK:
+      return std::unique_ptr<ReplacementPolicy> (new ClockPolicy ());
+    case VM_POLICY_FIFO:
+      return std::unique_ptr<ReplacementPolicy> (new StampPolicy (false));
+    case VM_POLICY_CAR:
+      return std::unique_ptr<ReplacementPolicy> (new CarPolicy ());
+  }
+  return std::unique_ptr<ReplacementPolicy> ();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "MemoryGeometry.h"
+#include "VMPolicy.h"
+
+#include <memory>
+
+/*
+ * chooses the pages a virtual memory evicts. the virtual memory reports
+ * every page it maps into and unmaps from a frame and, if the policy asks
+ * for it, every reference to a resident page.
+ *
+ * on_map and on_unmap are never called concurrently with each other or with
+ * choose_victim. in the concurrent build on_access may be called from any
+ * number of threads at any time, also with a frame that was just unmapped,
+ * so it must only do relaxed updates through Locks.h.
+ */
+class ReplacementPolicy
+{
+ public:
+  virtual ~ReplacementPolicy ()
+  {}
+
+  // forgets all pages, for a memory of the given size
+  virtual void reset (uint64_t num_frames, uint64_t num_pages) = 0;
+
+  virtual void on_map (uint64_t page, word_t frame) = 0;
+  virtual void on_unmap (uint64_t page, word_t frame) = 0;
+
+  // whether on_access has to be called at all
+  virtual bool tracks_accesses () const
+  { return false; }
+  virtual void on_access (uint64_t page, word_t frame)
+  {
+    (void) page;
+    (void) frame;
+  }
+
+  /*
+   * returns the frame of the resident page to evict so that page can be
+   * mapped, or 0 if no page is resident. the page is unmapped afterwards.
+   */
+  virtual word_t choose_victim (uint64_t page) = 0;
+};
+
+/*
+ * creates a policy of the given kind, or returns NULL for an unknown kind
+ */
+std::unique_ptr<ReplacementPolicy>
+create_replacement_policy (VMReplacementPolicy kind);
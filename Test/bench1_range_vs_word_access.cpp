@@ -0,0 +1,77 @@
+#include "VirtualMemory.h"
+#include "PhysicalMemory.h"
+
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+#include <vector>
+
+// compares the per-word cost of the VMwrite/VMread loop used in
+// test1_write_read_all_virtual_memory.cpp with VMwriteRange/VMreadRange
+
+#define CHUNK_WORDS (4 * PAGE_SIZE)
+
+typedef std::chrono::steady_clock bench_clock;
+
+double ns_per_word(bench_clock::time_point start, bench_clock::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - start).count()
+           / VIRTUAL_MEMORY_SIZE;
+}
+
+int main() {
+    std::vector<word_t> buf(CHUNK_WORDS);
+
+    VMinitialize();
+    bench_clock::time_point start = bench_clock::now();
+    for (uint64_t i = 0; i < VIRTUAL_MEMORY_SIZE; ++i) {
+        VMwrite(i, i);
+    }
+    bench_clock::time_point end = bench_clock::now();
+    printf("word  write: %8.1f ns/word\n", ns_per_word(start, end));
+
+    start = bench_clock::now();
+    for (uint64_t i = 0; i < VIRTUAL_MEMORY_SIZE; ++i) {
+        word_t value;
+        VMread(i, &value);
+        assert(uint64_t(value) == i);
+    }
+    end = bench_clock::now();
+    printf("word  read:  %8.1f ns/word\n", ns_per_word(start, end));
+
+    VMinitialize();
+    start = bench_clock::now();
+    for (uint64_t i = 0; i < VIRTUAL_MEMORY_SIZE; i += CHUNK_WORDS) {
+        size_t count = VIRTUAL_MEMORY_SIZE - i < CHUNK_WORDS ?
+                       VIRTUAL_MEMORY_SIZE - i : CHUNK_WORDS;
+        for (size_t j = 0; j < count; ++j) {
+            buf[j] = i + j;
+        }
+        VMwriteRange(i, buf.data(), count);
+    }
+    end = bench_clock::now();
+    printf("range write: %8.1f ns/word\n", ns_per_word(start, end));
+
+    start = bench_clock::now();
+    for (uint64_t i = 0; i < VIRTUAL_MEMORY_SIZE; i += CHUNK_WORDS) {
+        size_t count = VIRTUAL_MEMORY_SIZE - i < CHUNK_WORDS ?
+                       VIRTUAL_MEMORY_SIZE - i : CHUNK_WORDS;
+        VMreadRange(i, buf.data(), count);
+        for (size_t j = 0; j < count; ++j) {
+            assert(uint64_t(buf[j]) == i + j);
+        }
+    }
+    end = bench_clock::now();
+    printf("range read:  %8.1f ns/word\n", ns_per_word(start, end));
+
+    word_t value = 0;
+    int readPastEnd = VMreadRange(VIRTUAL_MEMORY_SIZE - 1, &value, 2);
+    int writtenPastEnd = VMwriteRange(VIRTUAL_MEMORY_SIZE, &value, 0);
+    assert(!readPastEnd);
+    assert(!writtenPastEnd);
+    (void) readPastEnd;
+    (void) writtenPastEnd;
+
+    printf("success\n");
+
+    return 0;
+}
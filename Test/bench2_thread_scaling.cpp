@@ -0,0 +1,106 @@
+#include "VirtualMemory.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// measures VMread/VMwrite throughput from 1 to N threads. build the library
+// with VM_CONCURRENT (and without INC_TESTING_CODE, whose trace adds to
+// every PM access), as the "thread_scaling" target of CMakeLists.txt does.
+// the thread count goes up to the first argument, by default the number of
+// hardware threads.
+//
+// every thread works on its own slice of the virtual memory and checks that
+// it reads back what it wrote, so lost updates under concurrent faults and
+// evictions show up as failures. "resident" keeps each thread on a few pages,
+// so nearly every access is a hit, "faulting" spreads the accesses over the
+// whole slice, so most of them fault and evict.
+
+#ifndef OPS_PER_THREAD
+#define OPS_PER_THREAD 200000
+#endif
+#define RESIDENT_PAGES 2
+#define WRITE_PERCENT 10
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct worker_result {
+    bool ok;
+};
+
+void worker(int id, int threads, uint64_t span, worker_result* result) {
+    uint64_t slice = VIRTUAL_MEMORY_SIZE / threads;
+    uint64_t base = id * slice;
+    if (span > slice)
+        span = slice;
+    std::vector<word_t> shadow(span, 0);
+    std::vector<bool> written(span, false);
+    uint64_t state = 0x9e3779b97f4a7c15ull * (id + 1);
+
+    result->ok = true;
+    for (int op = 0; op < OPS_PER_THREAD; ++op) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t index = state % span;
+        if (state % 100 < WRITE_PERCENT) {
+            word_t value = (word_t) (state >> 32);
+            VMwrite(base + index, value);
+            shadow[index] = value;
+            written[index] = true;
+        } else {
+            word_t value;
+            VMread(base + index, &value);
+            if (written[index] && value != shadow[index])
+                result->ok = false;
+        }
+    }
+}
+
+bool run(const char* name, int threads, uint64_t span) {
+    VMinitialize();
+    std::vector<std::thread> pool;
+    std::vector<worker_result> results(threads);
+
+    bench_clock::time_point start = bench_clock::now();
+    for (int i = 0; i < threads; ++i)
+        pool.push_back(std::thread(worker, i, threads, span, &results[i]));
+    for (int i = 0; i < threads; ++i)
+        pool[i].join();
+    bench_clock::time_point end = bench_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    VMStats stats;
+    VMgetStats(&stats);
+    printf("%-9s threads %2d: %8.2f Mops/s  faults %llu\n", name, threads,
+           (double) OPS_PER_THREAD * threads / seconds / 1e6,
+           (unsigned long long) (stats.minor_faults + stats.major_faults));
+
+    for (int i = 0; i < threads; ++i) {
+        if (!results[i].ok) {
+            printf("thread %d read back a wrong value\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int) std::thread::hardware_concurrency();
+    if (maxThreads < 1)
+        maxThreads = 1;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        if (!run("resident", threads, RESIDENT_PAGES * PAGE_SIZE))
+            return 1;
+    }
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        if (!run("faulting", threads, VIRTUAL_MEMORY_SIZE))
+            return 1;
+    }
+    printf("success\n");
+
+    return 0;
+}
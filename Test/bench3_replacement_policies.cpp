@@ -0,0 +1,118 @@
+#include "VirtualMemoryInstance.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// compares the replacement policies on the NORMAL geometry (64 frames of 16
+// words, 4 table levels) for a few page reference patterns, reporting the
+// miss ratio, the time per reference and the time per fault (the whole run
+// divided by the faults, which dominate it whenever the miss ratio is high)
+//
+//   loop      cycles over 48 pages, a few more than fit next to the tables
+//   uniform   uniform over 4096 pages
+//   zipf      zipf(1.0) over 4096 pages
+//   scan      80% of the references to 16 hot pages, the rest a sequential
+//             scan over the whole address space
+
+#define REFERENCES 200000
+#define ZIPF_PAGES 4096
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct policy_name {
+    VMReplacementPolicy policy;
+    const char* name;
+};
+
+const policy_name policies[] = {
+        {VM_POLICY_CYCLIC_DISTANCE, "cyclic"},
+        {VM_POLICY_LRU, "lru"},
+        {VM_POLICY_CLOCK, "clock"},
+        {VM_POLICY_FIFO, "fifo"},
+        {VM_POLICY_CAR, "car"},
+};
+
+uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+// spreads page ranks over the address space, so that hot pages are not
+// neighbours
+uint64_t spread(uint64_t rank, uint64_t numPages) {
+    return (rank * 0x9e3779b1ull) % numPages;
+}
+
+std::vector<uint64_t> make_pattern(const char* name, uint64_t numPages) {
+    std::vector<uint64_t> pages(REFERENCES);
+    uint64_t state = 88172645463325252ull;
+    std::string pattern(name);
+
+    if (pattern == "loop") {
+        for (size_t i = 0; i < pages.size(); ++i)
+            pages[i] = spread(i % 48, numPages);
+    } else if (pattern == "uniform") {
+        for (size_t i = 0; i < pages.size(); ++i)
+            pages[i] = spread(next_random(&state) % ZIPF_PAGES, numPages);
+    } else if (pattern == "zipf") {
+        std::vector<double> cdf(ZIPF_PAGES);
+        double sum = 0;
+        for (size_t i = 0; i < cdf.size(); ++i)
+            cdf[i] = sum += 1.0 / (i + 1);
+        for (size_t i = 0; i < pages.size(); ++i) {
+            double u = (next_random(&state) >> 11) * (1.0 / (1ull << 53)) * sum;
+            uint64_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+            pages[i] = spread(std::min<uint64_t>(rank, ZIPF_PAGES - 1), numPages);
+        }
+    } else {
+        uint64_t scan = 0;
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (next_random(&state) % 100 < 80)
+                pages[i] = spread(next_random(&state) % 16, numPages);
+            else
+                pages[i] = scan++ % numPages;
+        }
+    }
+    return pages;
+}
+
+int main() {
+    const char* patterns[] = {"loop", "uniform", "zipf", "scan"};
+    std::unique_ptr<VirtualMemory> vm = create_virtual_memory(4, 10, 20);
+    const MemoryGeometry& geometry = vm->geometry();
+
+    printf("%-8s %-7s %10s %10s %10s\n", "pattern", "policy", "miss", "ns/ref", "ns/fault");
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p) {
+        std::vector<uint64_t> pages = make_pattern(patterns[p], geometry.numPages);
+        for (size_t k = 0; k < sizeof(policies) / sizeof(policies[0]); ++k) {
+            vm->initialize_with_policy(policies[k].policy);
+            word_t value;
+            bench_clock::time_point start = bench_clock::now();
+            for (size_t i = 0; i < pages.size(); ++i) {
+                if (i % 4 == 0)
+                    vm->write(pages[i] * geometry.pageSize, (word_t) i);
+                else
+                    vm->read(pages[i] * geometry.pageSize, &value);
+            }
+            bench_clock::time_point end = bench_clock::now();
+
+            VMStats stats;
+            vm->get_stats(&stats);
+            double ns = std::chrono::duration<double, std::nano>(end - start).count();
+            uint64_t faults = stats.minor_faults + stats.major_faults;
+            printf("%-8s %-7s %9.2f%% %10.1f %10.1f\n", patterns[p], policies[k].name,
+                   100.0 * faults / pages.size(), ns / pages.size(),
+                   faults ? ns / faults : 0.0);
+        }
+    }
+    vm->initialize_with_policy(VM_POLICY_CYCLIC_DISTANCE);
+    printf("success\n");
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include "VirtualMemoryInstance.h"
+
+#include <cstdio>
+#include <chrono>
+#include <memory>
+
+// measures readahead on the NORMAL geometry (64 frames of 16 words, 4 table
+// levels) for scans that write every page of a region once and then read it
+// back, so that the read pass restores every page from swap
+//
+//   sequential   every page of the first 2048
+//   stride       every 5th page, like SimpleTest.cpp
+//   random       2048 random pages, which readahead should leave alone
+
+#define SCAN_PAGES 2048
+#define RANDOM_SEED 88172645463325252ull
+
+typedef std::chrono::steady_clock bench_clock;
+
+uint64_t page_of(const char* pattern, uint64_t i, uint64_t* state) {
+    if (pattern[0] == 's' && pattern[1] == 'e')
+        return i;
+    if (pattern[0] == 's')
+        return 5 * i;
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state % (5 * SCAN_PAGES);
+}
+
+bool run(VirtualMemory& vm, const char* pattern, size_t readahead) {
+    const MemoryGeometry& geometry = vm.geometry();
+    vm.set_readahead(readahead);
+    vm.initialize();
+
+    uint64_t state = RANDOM_SEED;
+    for (uint64_t i = 0; i < SCAN_PAGES; ++i)
+        vm.write(page_of(pattern, i, &state) * geometry.pageSize, (word_t) i);
+
+    bench_clock::time_point start = bench_clock::now();
+    state = RANDOM_SEED;
+    for (uint64_t i = 0; i < SCAN_PAGES; ++i) {
+        word_t value;
+        uint64_t page = page_of(pattern, i, &state);
+        vm.read(page * geometry.pageSize, &value);
+        if (pattern[0] != 'r' && value != (word_t) i) {
+            printf("%s: read %d from page %llu, expected %llu\n", pattern, value,
+                   (unsigned long long) page, (unsigned long long) i);
+            return false;
+        }
+    }
+    bench_clock::time_point end = bench_clock::now();
+
+    VMStats stats;
+    vm.get_stats(&stats);
+    double us = std::chrono::duration<double, std::micro>(end - start).count();
+    printf("%-10s %9zu %8llu %8llu %10llu %8llu %8llu %10.0f\n", pattern, readahead,
+           (unsigned long long) stats.minor_faults, (unsigned long long) stats.major_faults,
+           (unsigned long long) stats.prefetches, (unsigned long long) stats.prefetch_hits,
+           (unsigned long long) stats.prefetch_wasted, us);
+    return true;
+}
+
+int main() {
+    const char* patterns[] = {"sequential", "stride", "random"};
+    const size_t windows[] = {0, 4, 16, 32};
+    std::unique_ptr<VirtualMemory> vm = create_virtual_memory(4, 10, 20);
+
+    printf("%-10s %9s %8s %8s %10s %8s %8s %10s\n", "pattern", "readahead", "minor", "major",
+           "prefetched", "useful", "wasted", "read us");
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p) {
+        for (size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); ++w) {
+            if (!run(*vm, patterns[p], windows[w]))
+                return 1;
+        }
+    }
+    printf("success\n");
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#include "VirtualMemoryInstance.h"
+
+#include <cstdio>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+// compares regular and huge pages on the NORMAL geometry (64 frames of 16
+// words, 4 table levels) for a buffer of 48 pages, which fits in RAM either
+// way: 3 huge pages or 48 pages next to their tables. the buffer is written
+// once and then read word by word, sequentially and at random.
+
+#define BUFFER_PAGES 48
+#define PASSES 50
+
+typedef std::chrono::steady_clock bench_clock;
+
+bool run(VirtualMemory& vm, size_t huge_pages, bool random) {
+    const MemoryGeometry& geometry = vm.geometry();
+    vm.initialize_with_huge_pages(huge_pages);
+    uint64_t words = BUFFER_PAGES * geometry.pageSize;
+
+    std::vector<word_t> data(words);
+    for (uint64_t i = 0; i < words; ++i)
+        data[i] = (word_t) (i * 7 + 1);
+    vm.write_range(0, data.data(), words);
+
+    std::vector<uint64_t> order(words);
+    uint64_t state = 88172645463325252ull;
+    for (uint64_t i = 0; i < words; ++i) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        order[i] = random ? state % words : i;
+    }
+
+    bench_clock::time_point start = bench_clock::now();
+    for (int pass = 0; pass < PASSES; ++pass) {
+        for (uint64_t i = 0; i < words; ++i) {
+            word_t value;
+            vm.read(order[i], &value);
+            if (value != data[order[i]]) {
+                printf("read %d from %llu, expected %d\n", value,
+                       (unsigned long long) order[i], data[order[i]]);
+                return false;
+            }
+        }
+    }
+    bench_clock::time_point end = bench_clock::now();
+
+    VMStats stats;
+    vm.get_stats(&stats);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%-10s %-5s %8llu %8llu %10llu %8.1f\n", random ? "random" : "sequential",
+           huge_pages ? "huge" : "small",
+           (unsigned long long) (stats.minor_faults + stats.major_faults),
+           (unsigned long long) stats.huge_faults, (unsigned long long) stats.tlb_misses,
+           ns / (PASSES * words));
+    return true;
+}
+
+int main() {
+    std::unique_ptr<VirtualMemory> vm = create_virtual_memory(4, 10, 20);
+
+    printf("%-10s %-5s %8s %8s %10s %8s\n", "pattern", "pages", "faults", "huge", "tlb miss",
+           "ns/word");
+    for (int random = 0; random < 2; ++random) {
+        if (!run(*vm, 0, random) || !run(*vm, BUFFER_PAGES / vm->geometry().pageSize, random))
+            return 1;
+    }
+    vm->initialize_with_huge_pages(0);
+    printf("success\n");
+
+    return 0;
+}
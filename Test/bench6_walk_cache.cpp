@@ -0,0 +1,68 @@
+#include "VirtualMemoryInstance.h"
+
+#include <cstdio>
+#include <chrono>
+#include <memory>
+
+// measures the paging structure cache on a geometry of 64 frames of 16 words
+// and 5 table levels for reads of pages that are sparse over the address
+// space but clustered: each burst picks one of a few clusters at random and
+// reads pages of it, which share every table. the table reads are those of
+// the walks after TLB misses, which without the cache would read one entry
+// of every level; lock free reads of a VM_CONCURRENT build are not counted.
+
+#define CLUSTERS 8
+#define BURSTS 20000
+#define BURST_LENGTH 8
+#define CLUSTER_PAGES 8
+#define RANDOM_SEED 88172645463325252ull
+
+typedef std::chrono::steady_clock bench_clock;
+
+uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main() {
+    std::unique_ptr<VirtualMemory> vm = create_virtual_memory(4, 10, 24);
+    const MemoryGeometry& geometry = vm->geometry();
+    vm->initialize();
+
+    // clusters spread over the address space, each spanning one leaf table
+    uint64_t clusters[CLUSTERS];
+    uint64_t state = RANDOM_SEED;
+    for (int c = 0; c < CLUSTERS; ++c)
+        clusters[c] = next_random(&state) % geometry.numPages & ~(geometry.pageSize - 1);
+
+    uint64_t walks = 0;
+    bench_clock::time_point start = bench_clock::now();
+    for (int burst = 0; burst < BURSTS; ++burst) {
+        uint64_t cluster = clusters[next_random(&state) % CLUSTERS];
+        for (int i = 0; i < BURST_LENGTH; ++i) {
+            uint64_t page = cluster + next_random(&state) % CLUSTER_PAGES;
+            word_t value;
+            vm->read(page * geometry.pageSize, &value);
+        }
+        walks += BURST_LENGTH;
+    }
+    bench_clock::time_point end = bench_clock::now();
+
+    VMStats stats;
+    vm->get_stats(&stats);
+    uint64_t uncached = stats.tlb_misses * geometry.tablesDepth;
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("%10s %10s %10s %10s %12s %8s\n", "reads", "tlb miss", "faults", "psc hits",
+           "table reads", "ns/read");
+    printf("%10llu %10llu %10llu %10llu %5llu/%-6llu %8.1f\n", (unsigned long long) walks,
+           (unsigned long long) stats.tlb_misses,
+           (unsigned long long) (stats.minor_faults + stats.major_faults),
+           (unsigned long long) stats.psc_hits,
+           (unsigned long long) (uncached - stats.psc_levels_skipped),
+           (unsigned long long) uncached, ns / walks);
+    printf("success\n");
+
+    return 0;
+}
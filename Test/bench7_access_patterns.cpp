@@ -0,0 +1,120 @@
+#include "VirtualMemory.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// runs VMread/VMwrite over a few access patterns on the configuration of
+// MemoryConstants.h selected at build time, and prints one CSV row per
+// pattern, to the file given as the first argument (appending, with a header
+// if the file is empty) or to stdout. build the library without
+// INC_TESTING_CODE, whose trace would dominate the timings; the "benchmarks"
+// target of CMakeLists.txt does so for every configuration there, and
+// "run_benchmarks" collects their rows in benchmarks.csv.
+//
+//   sequential   every word in order
+//   strided      one word per page, skipping a page in between
+//   uniform      uniform over all words
+//   zipf         zipf(1.0) over all pages, a uniform word of the page
+//   loop         cycles over the words of a quarter more pages than frames
+//
+// every fourth access is a write. all columns but ns_per_op are per virtual
+// access and deterministic, so they only change between releases when the
+// paging behaviour does.
+
+#ifndef BENCH_OPS
+#define BENCH_OPS 200000
+#endif
+#ifndef BENCH_CONFIG
+#define BENCH_CONFIG "custom"
+#endif
+#define RANDOM_SEED 88172645463325252ull
+
+typedef std::chrono::steady_clock bench_clock;
+
+uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+std::vector<uint64_t> make_pattern(const char* name) {
+    std::vector<uint64_t> addresses(BENCH_OPS);
+    uint64_t state = RANDOM_SEED;
+
+    if (strcmp(name, "sequential") == 0) {
+        for (size_t i = 0; i < addresses.size(); ++i)
+            addresses[i] = i % VIRTUAL_MEMORY_SIZE;
+    } else if (strcmp(name, "strided") == 0) {
+        for (size_t i = 0; i < addresses.size(); ++i)
+            addresses[i] = (2 * i * PAGE_SIZE) % VIRTUAL_MEMORY_SIZE;
+    } else if (strcmp(name, "uniform") == 0) {
+        for (size_t i = 0; i < addresses.size(); ++i)
+            addresses[i] = next_random(&state) % VIRTUAL_MEMORY_SIZE;
+    } else if (strcmp(name, "zipf") == 0) {
+        std::vector<double> cdf(NUM_PAGES);
+        double sum = 0;
+        for (size_t i = 0; i < cdf.size(); ++i)
+            cdf[i] = sum += 1.0 / (i + 1);
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            double u = (next_random(&state) >> 11) * (1.0 / (1ull << 53)) * sum;
+            uint64_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+            // spreads the ranks over the address space, so that hot pages
+            // are not neighbours
+            uint64_t page = (std::min<uint64_t>(rank, NUM_PAGES - 1) * 0x9e3779b1ull) % NUM_PAGES;
+            addresses[i] = page * PAGE_SIZE + next_random(&state) % PAGE_SIZE;
+        }
+    } else {
+        uint64_t pages = std::min<uint64_t>(NUM_FRAMES + (NUM_FRAMES + 3) / 4, NUM_PAGES);
+        for (size_t i = 0; i < addresses.size(); ++i)
+            addresses[i] = i % (pages * PAGE_SIZE);
+    }
+    return addresses;
+}
+
+int main(int argc, char** argv) {
+    const char* patterns[] = {"sequential", "strided", "uniform", "zipf", "loop"};
+
+    FILE* out = stdout;
+    if (argc > 1 && (out = fopen(argv[1], "a")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (out == stdout || ftell(out) == 0) {
+        fprintf(out, "config,offset_width,physical_address_width,virtual_address_width,"
+                     "pattern,ops,ns_per_op,faults_per_op,evictions_per_op,"
+                     "pm_reads_per_op,pm_writes_per_op\n");
+    }
+
+    for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); ++p) {
+        std::vector<uint64_t> addresses = make_pattern(patterns[p]);
+        VMinitialize();
+
+        word_t value;
+        bench_clock::time_point start = bench_clock::now();
+        for (size_t i = 0; i < addresses.size(); ++i) {
+            if (i % 4 == 0)
+                VMwrite(addresses[i], (word_t) i);
+            else
+                VMread(addresses[i], &value);
+        }
+        bench_clock::time_point end = bench_clock::now();
+
+        VMStats stats;
+        VMgetStats(&stats);
+        double ops = (double) addresses.size();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+        fprintf(out, "%s,%d,%d,%d,%s,%zu,%.1f,%.4f,%.4f,%.3f,%.3f\n", BENCH_CONFIG, OFFSET_WIDTH,
+                PHYSICAL_ADDRESS_WIDTH, VIRTUAL_ADDRESS_WIDTH, patterns[p], addresses.size(),
+                ns / ops, (stats.minor_faults + stats.major_faults) / ops,
+                (stats.direct_evictions + stats.background_evictions) / ops,
+                stats.pm_reads / ops, stats.pm_writes / ops);
+    }
+    if (out != stdout)
+        fclose(out);
+
+    return 0;
+}
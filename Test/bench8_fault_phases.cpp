@@ -0,0 +1,65 @@
+#include "VirtualMemoryInstance.h"
+
+#include <cstdio>
+#include <memory>
+
+// prints where the faults of uniformly random accesses spend their time, as
+// the latency percentiles of every phase of the fault path. the library has
+// to be built with VM_PHASE_TIMING, as the "fault_phases" target of
+// CMakeLists.txt does; the dfs phase is only timed if it is also built with
+// VM_VERIFY. a JSON copy of the table is written to the file given as the
+// first argument, if any.
+//
+// every fourth access is a write, so that evictions write pages back and
+// later faults restore them.
+
+#define OPS 200000
+#define RANDOM_SEED 88172645463325252ull
+
+uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+int main(int argc, char** argv) {
+    std::unique_ptr<VirtualMemory> vm = create_virtual_memory(4, 10, 20);
+    const MemoryGeometry& geometry = vm->geometry();
+    vm->initialize();
+
+    uint64_t state = RANDOM_SEED;
+    word_t value;
+    for (int i = 0; i < OPS; ++i) {
+        uint64_t address = next_random(&state) % geometry.virtualMemorySize;
+        if (i % 4 == 0)
+            vm->write(address, (word_t) i);
+        else
+            vm->read(address, &value);
+    }
+
+    std::unique_ptr<VMPhaseTiming> timing(new VMPhaseTiming());
+    vm->get_phase_timing(timing.get());
+    if (phaseTimingCount(timing.get(), VM_PHASE_MAP_PAGE) == 0) {
+        fprintf(stderr, "no phase was timed, build the library with VM_PHASE_TIMING\n");
+        return 1;
+    }
+
+    printf("%-14s %10s %10s %10s %10s %10s\n", "phase", "count", "p50 ns", "p99 ns", "p999 ns",
+           "max ns");
+    for (int i = 0; i < VM_PHASE_COUNT; ++i) {
+        VMPhase phase = (VMPhase) i;
+        printf("%-14s %10llu %10llu %10llu %10llu %10llu\n", phaseName(phase),
+               (unsigned long long) phaseTimingCount(timing.get(), phase),
+               (unsigned long long) phaseTimingPercentile(timing.get(), phase, 0.5),
+               (unsigned long long) phaseTimingPercentile(timing.get(), phase, 0.99),
+               (unsigned long long) phaseTimingPercentile(timing.get(), phase, 0.999),
+               (unsigned long long) phaseTimingPercentile(timing.get(), phase, 1.0));
+    }
+    if (argc > 1 && !writePhaseTimingJson(timing.get(), argv[1])) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// prints the text of a physical memory trace written by Trace::dump, one line
+// per PM call, as the stringstream trace used to log it, after a line saying
+// how many events were dropped if the rings overflowed:
+//
+//   decode_pm_trace DUMP
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s DUMP\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<TraceEvent> events;
+    uint64_t dropped;
+    if (!readTraceEvents(argv[1], &events, &dropped)) {
+        fprintf(stderr, "%s: not a readable trace dump\n", argv[1]);
+        return 1;
+    }
+    std::string text;
+    formatTraceDropped(dropped, &text);
+    for (size_t i = 0; i < events.size(); ++i) {
+        formatTraceEvent(events[i], &text);
+        if (text.size() >= 1 << 16) {
+            fputs(text.c_str(), stdout);
+            text.clear();
+        }
+    }
+    fputs(text.c_str(), stdout);
+
+    return 0;
+}
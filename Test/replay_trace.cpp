@@ -0,0 +1,174 @@
+#include "AccessTrace.h"
+#include "VirtualMemoryInstance.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+// replays a trace recorded with VMstartRecording through a virtual memory of
+// the trace's geometry, as fast as it can, and reports the throughput and the
+// paging statistics. the virtual memory can be configured differently from
+// the recording run, to compare policies and engine changes on a real
+// workload:
+//
+//   replay_trace [-p cyclic|lru|clock|fifo|car] [-r readahead pages]
+//                [-H huge pages] [-w reclaimer low watermark] TRACE
+//
+// accesses that fail differently than when recorded, and reads of words
+// written earlier in the trace that return another word, are counted as
+// mismatches, which any configuration should have none of. other reads are
+// not checked: a word that was never written reads as whatever the page
+// evicted last from its frame left there. build without
+// INC_TESTING_CODE, whose trace would dominate the timings, as the
+// "replay_trace" target of CMakeLists.txt does.
+
+typedef std::chrono::steady_clock bench_clock;
+
+struct policy_name {
+    VMReplacementPolicy policy;
+    const char* name;
+};
+
+const policy_name policies[] = {
+        {VM_POLICY_CYCLIC_DISTANCE, "cyclic"},
+        {VM_POLICY_LRU, "lru"},
+        {VM_POLICY_CLOCK, "clock"},
+        {VM_POLICY_FIFO, "fifo"},
+        {VM_POLICY_CAR, "car"},
+};
+
+int usage(const char* program) {
+    fprintf(stderr, "usage: %s [-p cyclic|lru|clock|fifo|car] [-r readahead pages] "
+                    "[-H huge pages] [-w reclaimer low watermark] TRACE\n", program);
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    const policy_name* policy = &policies[0];
+    size_t readahead = 0, huge_pages = 0, low_watermark = 0;
+    int option;
+    while ((option = getopt(argc, argv, "p:r:H:w:")) != -1) {
+        if (option == 'p') {
+            policy = NULL;
+            for (size_t k = 0; k < sizeof(policies) / sizeof(policies[0]); ++k) {
+                if (strcmp(optarg, policies[k].name) == 0)
+                    policy = &policies[k];
+            }
+            if (policy == NULL)
+                return usage(argv[0]);
+        } else if (option == 'r') {
+            readahead = strtoul(optarg, NULL, 10);
+        } else if (option == 'H') {
+            huge_pages = strtoul(optarg, NULL, 10);
+        } else if (option == 'w') {
+            low_watermark = strtoul(optarg, NULL, 10);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1)
+        return usage(argv[0]);
+
+    access_trace trace;
+    if (!read_access_trace(argv[optind], &trace)) {
+        fprintf(stderr, "%s: not a readable access trace\n", argv[optind]);
+        return 1;
+    }
+    const MemoryGeometry& geometry = trace.geometry;
+    std::unique_ptr<VirtualMemory> vm = create_virtual_memory(
+            geometry.offsetWidth, geometry.physicalAddressWidth, geometry.virtualAddressWidth);
+    if (!vm) {
+        fprintf(stderr, "%s: the memory of the trace geometry cannot be allocated\n", argv[optind]);
+        return 1;
+    }
+    vm->set_readahead(readahead);
+    if (!vm->initialize_with_policy(policy->policy)
+        || !vm->initialize_with_huge_pages(huge_pages)
+        || !vm->initialize_with_reclaimer(low_watermark)) {
+        fprintf(stderr, "the configuration does not fit the geometry of the trace\n");
+        return 1;
+    }
+
+    size_t longest_range = 0;
+    uint64_t words = 0;
+    std::unordered_set<uint64_t> written_words;
+    std::vector<bool> checked(trace.records.size());
+    for (size_t i = 0; i < trace.records.size(); ++i) {
+        const access_record& record = trace.records[i];
+        bool range = record.op == ACCESS_READ_RANGE || record.op == ACCESS_WRITE_RANGE;
+        if (range)
+            longest_range = std::max<size_t>(longest_range, record.value);
+        words += range ? record.value : 1;
+        if (record.op == ACCESS_READ)
+            checked[i] = written_words.count(record.address) != 0;
+        if (record.op == ACCESS_WRITE && !record.failed)
+            written_words.insert(record.address);
+        if (record.op == ACCESS_WRITE_RANGE && !record.failed) {
+            for (uint64_t k = 0; k < record.value; ++k)
+                written_words.insert(record.address + k);
+        }
+    }
+    std::vector<word_t> range_buffer(longest_range);
+
+    uint64_t mismatches = 0;
+    const word_t* written = trace.words.data();
+    bench_clock::time_point start = bench_clock::now();
+    for (size_t i = 0; i < trace.records.size(); ++i) {
+        const access_record& record = trace.records[i];
+        word_t value = 0;
+        int success;
+        switch (record.op) {
+            case ACCESS_READ:
+                success = vm->read(record.address, &value);
+                if (checked[i] && success && value != (word_t) record.value)
+                    ++mismatches;
+                break;
+            case ACCESS_WRITE:
+                success = vm->write(record.address, (word_t) record.value);
+                break;
+            case ACCESS_READ_RANGE:
+                success = vm->read_range(record.address, range_buffer.data(), record.value);
+                break;
+            default:
+                success = vm->write_range(record.address, written, record.value);
+                written += record.value;
+                break;
+        }
+        if (success == record.failed)
+            ++mismatches;
+    }
+    bench_clock::time_point end = bench_clock::now();
+
+    VMStats stats;
+    vm->get_stats(&stats);
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    uint64_t accesses = trace.records.size();
+    printf("geometry       %d/%d/%d\n", geometry.offsetWidth, geometry.physicalAddressWidth,
+           geometry.virtualAddressWidth);
+    printf("accesses       %llu (%llu words)\n", (unsigned long long) accesses,
+           (unsigned long long) words);
+    printf("replay         %.3f ms, %.1f ns/access, %.0f accesses/s\n", ns / 1e6,
+           accesses ? ns / accesses : 0.0, ns > 0 ? accesses * 1e9 / ns : 0.0);
+    if (trace.timestamps && accesses != 0) {
+        printf("recorded       %.3f ms\n", trace.records.back().time / 1e6);
+    }
+    printf("minor faults   %llu\n", (unsigned long long) stats.minor_faults);
+    printf("major faults   %llu\n", (unsigned long long) stats.major_faults);
+    printf("evictions      %llu (%llu in the background, %llu clean)\n",
+           (unsigned long long) (stats.direct_evictions + stats.background_evictions),
+           (unsigned long long) stats.background_evictions,
+           (unsigned long long) stats.clean_evictions);
+    printf("huge evictions %llu\n", (unsigned long long) stats.huge_evictions);
+    printf("tlb misses     %llu\n", (unsigned long long) stats.tlb_misses);
+    printf("pm reads       %llu\n", (unsigned long long) stats.pm_reads);
+    printf("pm writes      %llu\n", (unsigned long long) stats.pm_writes);
+    printf("mismatches     %llu\n", (unsigned long long) mismatches);
+
+    return mismatches != 0;
+}
@@ -0,0 +1,68 @@
+#include "VirtualMemoryInstance.h"
+
+#include <cstdio>
+#include <cassert>
+
+// runs differently sized virtual memories side by side in one process, each
+// writing its whole address space and reading it back
+
+void write_read_all(VirtualMemory& vm, word_t salt) {
+    uint64_t size = vm.geometry().virtualMemorySize;
+    for (uint64_t i = 0; i < size; ++i) {
+        int written = vm.write(i, i ^ salt);
+        assert(written);
+        (void) written;
+    }
+    for (uint64_t i = 0; i < size; ++i) {
+        word_t value;
+        int read = vm.read(i, &value);
+        assert(read);
+        assert(value == word_t(i ^ salt));
+        (void) read;
+    }
+}
+
+int main() {
+    // the first three get prebuilt specializations, the last one is sized
+    // at runtime
+    std::unique_ptr<VirtualMemory> normalVm = create_virtual_memory(4, 10, 20);
+    std::unique_ptr<VirtualMemory> smallVm = create_virtual_memory(1, 4, 5);
+    std::unique_ptr<VirtualMemory> offsetDifferentVm = create_virtual_memory(2, 5, 7);
+    std::unique_ptr<VirtualMemory> oddVm = create_virtual_memory(3, 7, 11);
+    std::unique_ptr<VirtualMemory> invalidVm = create_virtual_memory(0, 4, 5);
+    assert(!invalidVm);
+    // valid, but far more RAM than can be allocated
+    std::unique_ptr<VirtualMemory> hugeVm = create_virtual_memory(4, 47, 47);
+    assert(!hugeVm);
+    VirtualMemory& normal = *normalVm;
+    VirtualMemory& small = *smallVm;
+    VirtualMemory& offsetDifferent = *offsetDifferentVm;
+    VirtualMemory& odd = *oddVm;
+    normal.initialize();
+    small.initialize();
+    offsetDifferent.initialize();
+    odd.initialize();
+
+    write_read_all(small, 0x55);
+    write_read_all(odd, 0x0f);
+    write_read_all(offsetDifferent, 0x33);
+    write_read_all(normal, 0x11);
+
+    // the other instances were not disturbed by the later ones
+    word_t smallValue = 0;
+    int smallRead = small.read(7, &smallValue);
+    assert(smallRead && smallValue == (7 ^ 0x55));
+    word_t oddValue = 0;
+    int oddRead = odd.read(1000, &oddValue);
+    assert(oddRead && oddValue == (1000 ^ 0x0f));
+    word_t outsideValue;
+    int outsideRead = small.read(small.geometry().virtualMemorySize, &outsideValue);
+    assert(!outsideRead);
+    (void) smallRead;
+    (void) oddRead;
+    (void) outsideRead;
+
+    printf("success\n");
+
+    return 0;
+}
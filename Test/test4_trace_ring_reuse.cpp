@@ -0,0 +1,63 @@
+#include "Trace.h"
+
+#include <cstdio>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+// spawns and joins short lived threads that record PM trace events, as a
+// program re-initializing a virtual memory with a reclaimer does. the rings
+// of exited threads are reused, so their number stays at the number of
+// threads alive at once, while the events of every thread are kept. then
+// overflows a ring, whose overwritten events have to be counted as dropped
+// and marked in the text of the trace. needs the library built with
+// INC_TESTING_CODE.
+
+#define ROUNDS 64
+#define THREADS 4
+#define EVENTS_PER_THREAD 10
+#define OVERFLOW_EVENTS (TRACE_RING_EVENTS + 5)
+
+void record_events(uint64_t thread) {
+    for (uint64_t i = 0; i < EVENTS_PER_THREAD; ++i)
+        Trace::record(TRACE_PM_WRITE, thread * EVENTS_PER_THREAD + i, i);
+}
+
+int main() {
+    size_t initialRings = Trace::ringCount();
+    for (int round = 0; round < ROUNDS; ++round) {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t)
+            threads.push_back(std::thread(record_events, (uint64_t) (round * THREADS + t)));
+        for (size_t t = 0; t < threads.size(); ++t)
+            threads[t].join();
+
+        size_t rings = Trace::ringCount();
+        assert(rings <= initialRings + THREADS);
+    }
+
+    std::vector<TraceEvent> events = Trace::events();
+    size_t recorded = 0;
+    for (size_t i = 0; i < events.size(); ++i) {
+        if ((events[i].sequence & ((1u << TRACE_KIND_BITS) - 1)) == TRACE_PM_WRITE)
+            ++recorded;
+    }
+    assert(recorded == ROUNDS * THREADS * EVENTS_PER_THREAD);
+    assert(Trace::dropped() == 0);
+
+    // the ring may have been given back by a thread, whose events are dropped
+    // first
+    for (uint64_t i = 0; i < OVERFLOW_EVENTS; ++i)
+        Trace::record(TRACE_PM_READ, i, 0);
+    uint64_t dropped = Trace::dropped();
+    assert(dropped >= 5);
+    assert(Trace::events().size() + dropped
+           == ROUNDS * THREADS * EVENTS_PER_THREAD + (uint64_t) OVERFLOW_EVENTS);
+    std::string contents = Trace().GetContents();
+    assert(contents.compare(0, 16, "TRACE TRUNCATED:") == 0);
+
+    printf("success\n");
+
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include "AccessTrace.h"
+
+#include <cstdio>
+#include <cassert>
+
+// writes a trace with AccessTraceWriter and reads it back with
+// read_access_trace. the addresses include failed accesses far outside any
+// virtual memory, whose deltas need all 64 bits, so every address has to
+// round-trip and not only those of a real geometry.
+
+#define TRACE_PATH "test5_access_trace_round_trip.vmtrace"
+
+int main() {
+    const word_t rangeWords[3] = {7, -1, 1 << 20};
+    const access_record records[] = {
+        {ACCESS_WRITE, false, 5, (uint64_t) (int64_t) -3, 0},
+        {ACCESS_READ, true, ~0ull, 0, 0},
+        {ACCESS_READ, true, (1ull << 63) + 5, 0, 0},
+        {ACCESS_READ, false, 5, (uint64_t) (int64_t) -3, 0},
+        {ACCESS_WRITE, true, 1ull << 63, 9, 0},
+        {ACCESS_READ_RANGE, true, ~0ull - 1, 12, 0},
+        {ACCESS_WRITE_RANGE, false, 0, 3, 0},
+        {ACCESS_READ, true, ~0ull, 0, 0},
+    };
+    const size_t count = sizeof(records) / sizeof(records[0]);
+
+    AccessTraceWriter writer;
+    bool opened = writer.open(TRACE_PATH, MemoryGeometry(4, 10, 20), false);
+    assert(opened);
+    (void) opened;
+    for (size_t i = 0; i < count; ++i) {
+        const access_record& record = records[i];
+        writer.record(record.op, record.address, record.value, record.failed,
+                      record.op == ACCESS_WRITE_RANGE ? rangeWords : NULL);
+    }
+    bool closed = writer.close();
+    assert(closed);
+    (void) closed;
+
+    access_trace trace;
+    bool read = read_access_trace(TRACE_PATH, &trace);
+    assert(read);
+    (void) read;
+    remove(TRACE_PATH);
+
+    assert(trace.records.size() == count);
+    for (size_t i = 0; i < count; ++i) {
+        assert(trace.records[i].op == records[i].op);
+        assert(trace.records[i].failed == records[i].failed);
+        assert(trace.records[i].address == records[i].address);
+        assert(trace.records[i].value == records[i].value);
+    }
+    assert(trace.words.size() == 3);
+    for (size_t i = 0; i < trace.words.size(); ++i)
+        assert(trace.words[i] == rangeWords[i]);
+
+    printf("success\n");
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+#include "Trace.h"
+#include "MemoryGeometry.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+// followed by the number of dropped events, then the events
+#define TRACE_DUMP_MAGIC "PMTRACE2"
+#define TRACE_DUMP_MAGIC_LENGTH 8
+
+void formatTraceEvent(const TraceEvent& event, std::string* text) {
+    char line[96];
+    unsigned long long first = event.first;
+    unsigned long long second = event.second;
+    switch (event.sequence & ((1u << TRACE_KIND_BITS) - 1)) {
+        case TRACE_PM_READ:
+            snprintf(line, sizeof(line), "PMread(%llu) = %d\n", first, (word_t) event.second);
+            break;
+        case TRACE_PM_WRITE:
+            snprintf(line, sizeof(line), "PMwrite(%llu, %d)\n", first, (word_t) event.second);
+            break;
+        case TRACE_PM_ZERO_FRAME:
+            snprintf(line, sizeof(line), "PMzeroFrame(%llu)\n", first);
+            break;
+        case TRACE_PM_EVICT:
+            snprintf(line, sizeof(line), "PMevict(%llu, %llu)\n", first, second);
+            break;
+        case TRACE_PM_RESTORE:
+            snprintf(line, sizeof(line), "PMrestore(%llu, %llu)\n", first, second);
+            break;
+        default:
+            return;
+    }
+    text->append(line);
+}
+
+void formatTraceDropped(uint64_t dropped, std::string* text) {
+    if (dropped == 0)
+        return;
+    char line[96];
+    snprintf(line, sizeof(line), "TRACE TRUNCATED: %llu oldest events dropped\n",
+             (unsigned long long) dropped);
+    text->append(line);
+}
+
+bool readTraceEvents(const char* path, std::vector<TraceEvent>* events, uint64_t* dropped) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL)
+        return false;
+
+    char magic[TRACE_DUMP_MAGIC_LENGTH];
+    uint64_t droppedEvents;
+    bool valid = fread(magic, 1, sizeof(magic), file) == sizeof(magic)
+                 && memcmp(magic, TRACE_DUMP_MAGIC, sizeof(magic)) == 0
+                 && fread(&droppedEvents, sizeof(droppedEvents), 1, file) == 1;
+    if (valid && dropped != NULL)
+        *dropped = droppedEvents;
+    events->clear();
+    TraceEvent event;
+    while (valid && fread(&event, sizeof(event), 1, file) == 1)
+        events->push_back(event);
+    valid = valid && !ferror(file);
+    fclose(file);
+    return valid;
+}
+
+#ifdef INC_TESTING_CODE
+
+thread_local Trace::Ring* Trace::localRing_ = NULL;
+uint64_t Trace::sequence_ = 0;
+
+// the rings, those of exited threads and the mutex guarding both are never
+// destroyed, since a background reclaimer may still record events during
+// static destruction
+std::vector<std::unique_ptr<Trace::Ring> >& Trace::rings() {
+    static std::vector<std::unique_ptr<Ring> >* allRings = new std::vector<std::unique_ptr<Ring> >();
+    return *allRings;
+}
+
+std::vector<Trace::Ring*>& Trace::freeRings() {
+    static std::vector<Ring*>* exited = new std::vector<Ring*>();
+    return *exited;
+}
+
+static std::mutex& ringsMutex() {
+    static std::mutex* mutex = new std::mutex();
+    return *mutex;
+}
+
+Trace::RingOwner::~RingOwner() {
+    std::lock_guard<std::mutex> hold(ringsMutex());
+    freeRings().push_back(localRing_);
+    localRing_ = NULL;
+}
+
+Trace::Ring* Trace::addRing() {
+    // constructed on the first event of the thread only, its destructor
+    // runs when the thread exits
+    static thread_local RingOwner owner;
+    (void) owner;
+    std::lock_guard<std::mutex> hold(ringsMutex());
+    if (freeRings().empty()) {
+        rings().push_back(std::unique_ptr<Ring>(new Ring()));
+        localRing_ = rings().back().get();
+    } else {
+        localRing_ = freeRings().back();
+        freeRings().pop_back();
+    }
+    return localRing_;
+}
+
+size_t Trace::ringCount() {
+    std::lock_guard<std::mutex> hold(ringsMutex());
+    return rings().size();
+}
+
+std::vector<TraceEvent> Trace::events() {
+    std::vector<TraceEvent> all;
+    {
+        std::lock_guard<std::mutex> hold(ringsMutex());
+        for (size_t r = 0; r < rings().size(); ++r) {
+            const Ring& ring = *rings()[r];
+            uint64_t first = ring.head > TRACE_RING_EVENTS ? ring.head - TRACE_RING_EVENTS : 0;
+            for (uint64_t i = first; i < ring.head; ++i)
+                all.push_back(ring.events[i & (TRACE_RING_EVENTS - 1)]);
+        }
+    }
+    std::sort(all.begin(), all.end(), [](const TraceEvent& a, const TraceEvent& b) {
+        return a.sequence < b.sequence;
+    });
+    return all;
+}
+
+uint64_t Trace::dropped() {
+    std::lock_guard<std::mutex> hold(ringsMutex());
+    uint64_t count = 0;
+    for (size_t r = 0; r < rings().size(); ++r) {
+        if (rings()[r]->head > TRACE_RING_EVENTS)
+            count += rings()[r]->head - TRACE_RING_EVENTS;
+    }
+    return count;
+}
+
+std::string Trace::GetContents() {
+    std::vector<TraceEvent> all = events();
+    std::string text;
+    formatTraceDropped(dropped(), &text);
+    for (size_t i = 0; i < all.size(); ++i)
+        formatTraceEvent(all[i], &text);
+    return text;
+}
+
+bool Trace::dump(const char* path) {
+    std::vector<TraceEvent> all = events();
+    uint64_t droppedEvents = dropped();
+    FILE* file = fopen(path, "wb");
+    if (file == NULL)
+        return false;
+    bool written = fwrite(TRACE_DUMP_MAGIC, 1, TRACE_DUMP_MAGIC_LENGTH, file) == TRACE_DUMP_MAGIC_LENGTH
+                   && fwrite(&droppedEvents, sizeof(droppedEvents), 1, file) == 1
+                   && fwrite(all.data(), sizeof(TraceEvent), all.size(), file) == all.size();
+    return fclose(file) == 0 && written;
+}
+
+#endif
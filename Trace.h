@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+/*
+ * the testing trace of physical memory operations. every PM call made while
+ * the library is built with INC_TESTING_CODE is recorded as a fixed size
+ * binary event in a ring of the calling thread; the text it used to log is
+ * only produced when the trace is read, by GetContents or by decoding a file
+ * written by Trace::dump, e.g. with Test/decode_pm_trace.cpp.
+ *
+ * the events and their decoding are available in every build, so that a
+ * dump can be decoded by any program.
+ */
+
+enum TraceEventKind {
+    TRACE_PM_READ,
+    TRACE_PM_WRITE,
+    TRACE_PM_ZERO_FRAME,
+    TRACE_PM_EVICT,
+    TRACE_PM_RESTORE
+};
+
+#define TRACE_KIND_BITS 3
+
+struct TraceEvent {
+    // the position of the event among the events of all threads, shifted
+    // left by TRACE_KIND_BITS, with the TraceEventKind in the low bits
+    uint64_t sequence;
+    // the physical address or frame index
+    uint64_t first;
+    // the word read or written, or the page index
+    uint64_t second;
+};
+
+/*
+ * appends the line the stringstream trace logged for event to text
+ */
+void formatTraceEvent(const TraceEvent& event, std::string* text);
+
+/*
+ * appends the line marking a trace that lost its dropped oldest events, if
+ * dropped is not 0
+ */
+void formatTraceDropped(uint64_t dropped, std::string* text);
+
+/*
+ * reads the events written by Trace::dump, and the number of events the
+ * rings dropped before it, if dropped is not NULL.
+ * returns false if the file cannot be read or is not a trace dump.
+ */
+bool readTraceEvents(const char* path, std::vector<TraceEvent>* events, uint64_t* dropped = NULL);
+
+#ifdef INC_TESTING_CODE
+
+// events kept per ring, a power of two. a thread that records more only
+// keeps its latest events, and the overwritten ones are counted by dropped.
+#ifndef TRACE_RING_EVENTS
+#define TRACE_RING_EVENTS (1u << 20)
+#endif
+
+class Trace {
+public:
+    Trace() {
+    }
+
+    /*
+     * records an event in the ring of the calling thread. lock free: the
+     * only shared write is the increment of the sequence counter.
+     *
+     * a thread takes a ring when it records its first event and gives it
+     * back when it exits, for the next thread to continue, so there are
+     * never more rings than threads recording at once.
+     */
+    inline static void record(TraceEventKind kind, uint64_t first, uint64_t second = 0) {
+        Ring* ring = localRing_;
+        if (ring == NULL)
+            ring = addRing();
+        TraceEvent& event = ring->events[ring->head & (TRACE_RING_EVENTS - 1)];
+        // atomic in every build, as any program may record from several threads
+        event.sequence = __atomic_add_fetch(&sequence_, 1, __ATOMIC_RELAXED) << TRACE_KIND_BITS | kind;
+        event.first = first;
+        event.second = second;
+        ++ring->head;
+    }
+
+    /*
+     * the events of every thread, oldest first. must not be called while
+     * other threads record events.
+     */
+    static std::vector<TraceEvent> events();
+
+    /*
+     * the number of events overwritten in the rings by newer ones, with the
+     * same restriction as events
+     */
+    static uint64_t dropped();
+
+    /*
+     * the text the stringstream trace logged for the recorded events, one
+     * line per event, with the same restriction as events. if events were
+     * dropped, the text starts with a line saying how many, so that it never
+     * passes for the whole trace.
+     */
+    std::string GetContents();
+
+    /*
+     * writes the recorded events and the number of dropped events to the
+     * file at path, for readTraceEvents.
+     * returns false if the file could not be written.
+     */
+    static bool dump(const char* path);
+
+    // the number of rings taken by threads since the program started
+    static size_t ringCount();
+
+private:
+    struct Ring {
+        Ring() : events(new TraceEvent[TRACE_RING_EVENTS]), head(0) {
+        }
+
+        std::unique_ptr<TraceEvent[]> events;
+        // the number of events the thread recorded
+        uint64_t head;
+    };
+
+    // gives the ring of a thread back when the thread exits
+    struct RingOwner {
+        ~RingOwner();
+    };
+
+    // takes a ring given back by an exited thread, or creates one, as the
+    // ring of the calling thread. rings outlive their threads, so that the
+    // events of every thread stay readable
+    static Ring* addRing();
+    static std::vector<std::unique_ptr<Ring> >& rings();
+    static std::vector<Ring*>& freeRings();
+
+    static thread_local Ring* localRing_;
+    static uint64_t sequence_;
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "VMPhaseTiming.h"
+
+#include <cmath>
+#include <cstdio>
+
+static const char *phase_names[VM_PHASE_COUNT] = {
+    "map_page",     "walk",        "locate_frame", "dfs",
+    "remove_frame", "clear_frame", "evict",        "restore",
+};
+
+// the longest duration of bucket
+static uint64_t bucket_high (int bucket)
+{
+  if (bucket < (1 << PHASE_SUB_BUCKET_BITS))
+  {
+    return (uint64_t) bucket;
+  }
+  int shift = (bucket >> PHASE_SUB_BUCKET_BITS) - 1;
+  uint64_t low = (uint64_t) ((1 << PHASE_SUB_BUCKET_BITS)
+                             | (bucket & ((1 << PHASE_SUB_BUCKET_BITS) - 1)))
+                 << shift;
+  return low + ((1ull << shift) - 1);
+}
+
+uint64_t phaseTimingCount (const VMPhaseTiming *timing, VMPhase phase)
+{
+  uint64_t count = 0;
+  for (int i = 0; i < PHASE_BUCKETS; ++i)
+  {
+    count += timing->buckets[phase][i];
+  }
+  return count;
+}
+
+uint64_t phaseTimingPercentile (const VMPhaseTiming *timing, VMPhase phase,
+                                double fraction)
+{
+  uint64_t count = phaseTimingCount (timing, phase);
+  if (count == 0)
+  {
+    return 0;
+  }
+  // the rank of the sample, at least the first and at most the last
+  uint64_t rank = (uint64_t) std::ceil (fraction * count);
+  rank = rank == 0 ? 1 : rank > count ? count : rank;
+  uint64_t seen = 0;
+  for (int i = 0; i < PHASE_BUCKETS; ++i)
+  {
+    seen += timing->buckets[phase][i];
+    if (seen >= rank)
+    {
+      return bucket_high (i);
+    }
+  }
+  return bucket_high (PHASE_BUCKETS - 1);
+}
+
+const char *phaseName (VMPhase phase)
+{
+  return phase_names[phase];
+}
+
+int writePhaseTimingJson (const VMPhaseTiming *timing, const char *path)
+{
+  FILE *file = fopen (path, "w");
+  if (file == NULL)
+  {
+    return 0;
+  }
+  fprintf (file, "{\n");
+  for (int i = 0; i < VM_PHASE_COUNT; ++i)
+  {
+    VMPhase phase = (VMPhase) i;
+    fprintf (file,
+             "  \"%s\": {\"count\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+             "\"p999_ns\": %llu, \"max_ns\": %llu}%s\n",
+             phase_names[i],
+             (unsigned long long) phaseTimingCount (timing, phase),
+             (unsigned long long) phaseTimingPercentile (timing, phase, 0.5),
+             (unsigned long long) phaseTimingPercentile (timing, phase, 0.99),
+             (unsigned long long) phaseTimingPercentile (timing, phase, 0.999),
+             (unsigned long long) phaseTimingPercentile (timing, phase, 1.0),
+             i + 1 < VM_PHASE_COUNT ? "," : "");
+  }
+  fprintf (file, "}\n");
+  bool failed = ferror (file);
+  return fclose (file) == 0 && !failed;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * latency histograms of the phases of the fault path, which are only timed
+ * when the library is built with VM_PHASE_TIMING. without it no phase is
+ * timed and every histogram stays empty.
+ *
+ * phases nest: a phase includes the time of the phases it calls, e.g. a
+ * walk that faults includes locating, clearing and linking the frames it
+ * takes.
+ */
+typedef enum
+{
+    // a TLB miss of resolve_frame: the walks, the fault and the restore
+    VM_PHASE_MAP_PAGE,
+    // a walk of the tables, including the faults it handles
+    VM_PHASE_WALK,
+    // locate_available_frame, finding a frame to link, evicting if needed
+    VM_PHASE_LOCATE_FRAME,
+    // the dfs over the tables, which only the VM_VERIFY build runs
+    VM_PHASE_DFS,
+    // unlinking a frame from its table
+    VM_PHASE_REMOVE_FRAME,
+    // zeroing a frame to become a table
+    VM_PHASE_CLEAR_FRAME,
+    // PMevict of a page, by a fault or the reclaimer
+    VM_PHASE_EVICT,
+    // PMrestore of a page, including waiting for the reclaimer to finish
+    // writing it back
+    VM_PHASE_RESTORE,
+    VM_PHASE_COUNT
+} VMPhase;
+
+/*
+ * the histograms are log-linear: durations of less than
+ * 2^PHASE_SUB_BUCKET_BITS nanoseconds have a bucket each, and every power of
+ * two above is split in 2^PHASE_SUB_BUCKET_BITS buckets, so a bucket spans
+ * at most an eighth of its lowest duration.
+ */
+#define PHASE_SUB_BUCKET_BITS 3
+#define PHASE_BUCKETS ((64 - PHASE_SUB_BUCKET_BITS + 1) << PHASE_SUB_BUCKET_BITS)
+
+typedef struct
+{
+    // the number of times each phase took the durations of each bucket
+    uint64_t buckets[VM_PHASE_COUNT][PHASE_BUCKETS];
+} VMPhaseTiming;
+
+// the bucket of a duration in nanoseconds
+inline int phaseTimingBucket(uint64_t nanoseconds)
+{
+    if (nanoseconds < (1u << PHASE_SUB_BUCKET_BITS))
+        return (int) nanoseconds;
+    int exponent = 63 - __builtin_clzll(nanoseconds);
+    int shift = exponent - PHASE_SUB_BUCKET_BITS;
+    return ((shift + 1) << PHASE_SUB_BUCKET_BITS)
+           | (int) ((nanoseconds >> shift) & ((1u << PHASE_SUB_BUCKET_BITS) - 1));
+}
+
+/*
+ * the longest duration in nanoseconds of the bucket holding the given
+ * fraction (e.g. 0.99) of the samples of phase, counting from the shortest.
+ * returns 0 if the phase was never timed.
+ */
+uint64_t phaseTimingPercentile(const VMPhaseTiming* timing, VMPhase phase, double fraction);
+
+// the number of times phase was timed
+uint64_t phaseTimingCount(const VMPhaseTiming* timing, VMPhase phase);
+
+// the name of phase in writePhaseTimingJson
+const char* phaseName(VMPhase phase);
+
+/*
+ * writes the count, p50, p99, p999 and maximum of every phase to the file at
+ * path as one JSON object with a member per phase, named like phaseName.
+ *
+ * returns 1 on success.
+ * returns 0 if the file could not be written.
+ */
+int writePhaseTimingJson(const VMPhaseTiming* timing, const char* path);
@@ -0,0 +1,21 @@
+#pragma once
+
+/*
+ * the rule used to choose the page to evict when no frame is free
+ */
+typedef enum
+{
+    // the page at maximal cyclic distance from the faulting page, the lowest
+    // such page on ties. the default.
+    VM_POLICY_CYCLIC_DISTANCE,
+    // the least recently referenced page
+    VM_POLICY_LRU,
+    // second chance: a clock hand sweeps the frames, sparing and clearing
+    // those referenced since it last passed
+    VM_POLICY_CLOCK,
+    // the page mapped longest ago
+    VM_POLICY_FIFO,
+    // CAR, clock with adaptive replacement: ARC's balance of recently and
+    // frequently used pages, driven by referenced bits. resists scans.
+    VM_POLICY_CAR
+} VMReplacementPolicy;
@@ -0,0 +1,59 @@
+#include "VMStats.h"
+
+#include <cstdio>
+
+// the fields of VMStats in declaration order, named for JSON
+static const struct
+{
+  const char *name;
+  uint64_t VMStats::*field;
+} stats_fields[] = {
+    {"words_read", &VMStats::words_read},
+    {"words_written", &VMStats::words_written},
+    {"tlb_hits", &VMStats::tlb_hits},
+    {"tlb_misses", &VMStats::tlb_misses},
+    {"table_walks", &VMStats::table_walks},
+    {"psc_hits", &VMStats::psc_hits},
+    {"psc_levels_skipped", &VMStats::psc_levels_skipped},
+    {"page_hits", &VMStats::page_hits},
+    {"minor_faults", &VMStats::minor_faults},
+    {"major_faults", &VMStats::major_faults},
+    {"restores", &VMStats::restores},
+    {"frames_cleared", &VMStats::frames_cleared},
+    {"dfs_nodes", &VMStats::dfs_nodes},
+    {"direct_evictions", &VMStats::direct_evictions},
+    {"background_evictions", &VMStats::background_evictions},
+    {"huge_faults", &VMStats::huge_faults},
+    {"huge_evictions", &VMStats::huge_evictions},
+    {"clean_evictions", &VMStats::clean_evictions},
+    {"writeback_bytes_saved", &VMStats::writeback_bytes_saved},
+    {"prefetches", &VMStats::prefetches},
+    {"prefetch_hits", &VMStats::prefetch_hits},
+    {"prefetch_wasted", &VMStats::prefetch_wasted},
+    {"pm_reads", &VMStats::pm_reads},
+    {"pm_writes", &VMStats::pm_writes},
+};
+
+static_assert (sizeof (stats_fields) / sizeof (stats_fields[0])
+               == sizeof (VMStats) / sizeof (uint64_t),
+               "every field of VMStats is in stats_fields");
+
+int writeStatsJson (const VMStats *stats, const char *path)
+{
+  FILE *file = fopen (path, "w");
+  if (file == NULL)
+  {
+    return 0;
+  }
+  size_t count = sizeof (stats_fields) / sizeof (stats_fields[0]);
+  fprintf (file, "{\n");
+  for (size_t i = 0; i < count; ++i)
+  {
+    fprintf (file, "  \"%s\": %llu%s\n", stats_fields[i].name,
+             (unsigned long long) (stats->*stats_fields[i].field),
+             i + 1 < count ? "," : "");
+  }
+  fprintf (file, "}\n");
+  bool failed = ferror (file);
+  return fclose (file) == 0 && !failed;
+}
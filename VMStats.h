@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * paging statistics, accumulated since the last call to VMinitialize. they
+ * are always counted, with a relaxed increment of a counter shared with few
+ * other threads, if any.
+ */
+typedef struct
+{
+    // words read and written by successful accesses, ranges included
+    uint64_t words_read;
+    uint64_t words_written;
+
+    uint64_t tlb_hits;
+    uint64_t tlb_misses;
+    // walks of the tables, by faults and TLB misses, including lock free
+    // attempts and walks retried after taking table_lock exclusively
+    uint64_t table_walks;
+
+    // table walks that started from a table in the paging structure cache
+    // instead of the root, and the table levels they did not read
+    uint64_t psc_hits;
+    uint64_t psc_levels_skipped;
+
+    // accesses to pages that were already resident
+    uint64_t page_hits;
+    // first references to pages that were never evicted
+    uint64_t minor_faults;
+    // references to evicted pages, each costing a PMrestore
+    uint64_t major_faults;
+    // pages restored from swap, by faults, readahead and huge pages
+    uint64_t restores;
+    // frames zeroed to become tables, the root table included
+    uint64_t frames_cleared;
+    // tables and pages visited by the dfs over the tables, which only the
+    // VM_VERIFY build runs to cross-check the frame allocator
+    uint64_t dfs_nodes;
+
+    // evictions done by a fault, before it could map its page
+    uint64_t direct_evictions;
+    // evictions done by the reclaimer ahead of demand
+    uint64_t background_evictions;
+
+    // faults that mapped a huge page, also counted as minor or major faults
+    uint64_t huge_faults;
+    // huge pages evicted, each evicting all of its pages
+    uint64_t huge_evictions;
+
+    // evictions of pages that were not written since they were restored. the
+    // copy they were restored from is still in swap, so they are not written
+    // back.
+    uint64_t clean_evictions;
+    // bytes not written to swap thanks to those
+    uint64_t writeback_bytes_saved;
+
+    // pages mapped by readahead ahead of their first reference
+    uint64_t prefetches;
+    // prefetched pages that were referenced before being evicted
+    uint64_t prefetch_hits;
+    // prefetched pages that were evicted without being referenced
+    uint64_t prefetch_wasted;
+
+    // PMread and PMwrite calls
+    uint64_t pm_reads;
+    uint64_t pm_writes;
+} VMStats;
+
+/*
+ * writes stats to the file at path as one JSON object with a number member
+ * for every field, named like it.
+ *
+ * returns 1 on success.
+ * returns 0 if the file could not be written.
+ */
+int writeStatsJson(const VMStats* stats, const char* path);
@@ -1,193 +1,137 @@
 #include "VirtualMemory.h"
+#include "AccessTrace.h"
 #include "PhysicalMemory.h"
+#include "VirtualMemoryInstance.h"
 
-// definitions
-#define INITIAL_FRAME_VALUE 0
-#define START_FRAME 0
-typedef struct
-{
-    word_t max_frame_taken;
-    word_t max_cyclic_page;
-    word_t max_cyclic_frame;
-    word_t max_cyclic_dist;
-    word_t empty_frame;
-} dfsRes;
-bool is_address_legal (uint64_t virtual_address);
-uint64_t combine_binary (uint64_t cur_path, uint64_t to_add);
-word_t calculate_cyclic_distance (word_t in_page, word_t ref_page);
-void clear_frame (word_t frame);
-void process_leaf ( word_t frame, uint64_t page, uint64_t path,dfsRes *result);
-void dfs (int level, uint64_t page, word_t frame, uint64_t parent,
-          dfsRes *result, uint64_t path);
-void remove_frame (int level , word_t target_frame, word_t current_frame);
-word_t locate_available_frame (uint64_t parent, uint64_t page);
-word_t resolve_frame (uint64_t virtualAddress);
-
-bool is_address_legal (uint64_t virtual_address)
-{
-  if (virtual_address >= VIRTUAL_MEMORY_SIZE || TABLES_DEPTH >= NUM_FRAMES)
-  {
-    return false;
-  }
-  return true;
+#include <utility>
+
+// the VM* functions drive a single virtual memory sized by
+// MemoryConstants.h, on top of the physical memory used by the PM* functions
+VirtualMemory &default_vm ()
+{
+  static std::unique_ptr<VirtualMemory> vm (
+      create_virtual_memory (defaultPhysicalMemory ()));
+  return *vm;
 }
-// Helper Functions
-uint64_t combine_binary (uint64_t cur_path, uint64_t to_add)
+
+// the trace of the VM* accesses while recording, NULL otherwise
+static std::unique_ptr<AccessTraceWriter> recorder;
+
+void VMinitialize ()
 {
-  return (cur_path << OFFSET_WIDTH) + to_add;
+  default_vm ().initialize ();
 }
 
-word_t calculate_cyclic_distance (word_t in_page, word_t ref_page)
+int VMinitializeWithSwapFile (const char *path)
 {
-  int diff = in_page - ref_page;
-  int abs_diff = diff > 0 ? diff : -diff;
-  if (NUM_PAGES - abs_diff < abs_diff)
-  {
-    return (word_t) (NUM_PAGES - abs_diff);
-  }
-  return abs_diff;
+  return default_vm ().initialize_with_swap_file (path);
 }
 
-void clear_frame (word_t frame)
+int VMinitializeWithPolicy (VMReplacementPolicy policy)
 {
-  for (int i = 0; i < PAGE_SIZE; ++i)
-  {
-    PMwrite (frame * PAGE_SIZE + i, INITIAL_FRAME_VALUE);
-  }
+  return default_vm ().initialize_with_policy (policy);
 }
 
-void process_leaf (word_t frame, uint64_t page, uint64_t path,dfsRes *result)
+int VMinitializeWithReclaimer (size_t lowWatermark)
 {
-  if (frame > result->max_frame_taken)
-    result->max_frame_taken = frame;
+  return default_vm ().initialize_with_reclaimer (lowWatermark);
+}
 
-  word_t cyclic_dist = calculate_cyclic_distance ((word_t) page, (word_t) path);
-  if (cyclic_dist > result->max_cyclic_dist)
-  {
-    result->max_cyclic_dist = cyclic_dist;
-    result->max_cyclic_page = (word_t) path;
-    result->max_cyclic_frame = frame;
-  }
+int VMinitializeWithHugePages (size_t count)
+{
+  return default_vm ().initialize_with_huge_pages (count);
 }
 
-void dfs (int level, uint64_t page, word_t frame, uint64_t parent,
-          dfsRes *result, uint64_t path)
+void VMsetReadahead (size_t maxPages)
 {
-  if (level == TABLES_DEPTH)
-  {
-    process_leaf ( frame, page, path,result);
-    return;
-  }
+  default_vm ().set_readahead (maxPages);
+}
 
-  int empty_childs = 0;
-  for (int i = 0; i < PAGE_SIZE; ++i)
-  {
-    word_t child;
-    PMread (frame * PAGE_SIZE + i, &child);
-    if (child == 0)
-    {
-      empty_childs++;
-      continue;
-    }
-
-    dfs (level + 1, page, child, parent, result, combine_binary (path, i));
-  }
+void VMgetStats (VMStats *stats)
+{
+  default_vm ().get_stats (stats);
+}
 
-  if (empty_childs == PAGE_SIZE && frame != (word_t) parent
-      && frame < result->empty_frame)
-  {
-    result->empty_frame = frame;
-  }
+int VMdumpStats (const char *path)
+{
+  VMStats stats;
+  default_vm ().get_stats (&stats);
+  return writeStatsJson (&stats, path);
+}
 
-  if (frame > result->max_frame_taken)
-    result->max_frame_taken = frame;
+void VMgetPhaseTiming (VMPhaseTiming *timing)
+{
+  default_vm ().get_phase_timing (timing);
 }
 
-void remove_frame (int level,word_t target_frame, word_t current_frame )
+int VMdumpPhaseTiming (const char *path)
 {
-  if (level == TABLES_DEPTH) return;
+  std::unique_ptr<VMPhaseTiming> timing (new VMPhaseTiming ());
+  default_vm ().get_phase_timing (timing.get ());
+  return writePhaseTimingJson (timing.get (), path);
+}
 
-  for (int i = 0; i < PAGE_SIZE; ++i)
+int VMread (uint64_t virtualAddress, word_t *value)
+{
+  int success = default_vm ().read (virtualAddress, value);
+  if (recorder)
   {
-    word_t child;
-    PMread (current_frame * PAGE_SIZE + i, &child);
-
-    if (child == 0) continue;
-    if (child == target_frame)
-    {
-      PMwrite (current_frame * PAGE_SIZE + i, INITIAL_FRAME_VALUE);
-      return;
-    }
-    remove_frame (level + 1,target_frame, child );
+    recorder->record (ACCESS_READ, virtualAddress, success ? *value : 0,
+                      !success);
   }
+  return success;
 }
 
-word_t locate_available_frame (uint64_t parent, uint64_t page)
+int VMwrite (uint64_t virtualAddress, word_t value)
 {
-  dfsRes result = {0, 0, 0, 0, NUM_FRAMES};
-  dfs (0, page, 0, parent, &result, 0);
-
-  if (result.empty_frame != NUM_FRAMES)
-  {
-    remove_frame (0, result.empty_frame, START_FRAME );
-    return result.empty_frame;
-  }
-  if (result.max_frame_taken < NUM_FRAMES - 1)
+  int success = default_vm ().write (virtualAddress, value);
+  if (recorder)
   {
-    return result.max_frame_taken + 1;
+    recorder->record (ACCESS_WRITE, virtualAddress, value, !success);
   }
-  PMevict (result.max_cyclic_frame, result.max_cyclic_page);
-  remove_frame (0, result.max_cyclic_frame, START_FRAME);
-  return result.max_cyclic_frame;
+  return success;
 }
 
-word_t resolve_frame (uint64_t virtualAddress)
+int VMreadRange (uint64_t virtualAddress, word_t *buf, size_t count)
 {
-  word_t next_address = 0;
-  word_t current_address = 0;
-  uint64_t page = virtualAddress >> OFFSET_WIDTH;
-
-  for (int level = 0; level < TABLES_DEPTH; level++)
+  int success = default_vm ().read_range (virtualAddress, buf, count);
+  if (recorder)
   {
-    uint64_t offset =
-        (virtualAddress >> ((TABLES_DEPTH - level) * OFFSET_WIDTH))
-        & ((1ll << OFFSET_WIDTH) - 1);
-    PMread (current_address * PAGE_SIZE + offset, &next_address);
-    if (next_address == 0)
-    {
-      next_address = locate_available_frame (current_address, page);
-      if (level < TABLES_DEPTH - 1) clear_frame (next_address);
-      PMwrite (current_address * PAGE_SIZE + offset, next_address);
-    }
-    current_address = next_address;
+    recorder->record (ACCESS_READ_RANGE, virtualAddress, count, !success);
   }
-  PMrestore (next_address, page);
-  return current_address * PAGE_SIZE + virtualAddress % PAGE_SIZE;
+  return success;
 }
 
-void VMinitialize ()
+int VMwriteRange (uint64_t virtualAddress, const word_t *buf, size_t count)
 {
-  clear_frame (START_FRAME);
+  int success = default_vm ().write_range (virtualAddress, buf, count);
+  if (recorder)
+  {
+    recorder->record (ACCESS_WRITE_RANGE, virtualAddress, count, !success,
+                      buf);
+  }
+  return success;
 }
 
-int VMread (uint64_t virtualAddress, word_t *value)
+int VMstartRecording (const char *path, int timestamps)
 {
-  if (!is_address_legal (virtualAddress))
+  VMstopRecording ();
+  std::unique_ptr<AccessTraceWriter> writer (new AccessTraceWriter ());
+  if (!writer->open (path, default_vm ().geometry (), timestamps != 0))
   {
     return 0;
   }
-  word_t frame_addr = resolve_frame (virtualAddress);
-  PMread (frame_addr, value);
+  recorder = std::move (writer);
   return 1;
 }
 
-int VMwrite (uint64_t virtualAddress, word_t value)
+int VMstopRecording ()
 {
-  if (!is_address_legal (virtualAddress))
+  if (!recorder)
   {
     return 0;
   }
-  word_t frame_addr = resolve_frame (virtualAddress);
-  PMwrite (frame_addr, value);
-  return 1;
+  int success = recorder->close ();
+  recorder.reset ();
+  return success;
 }
@@ -1,5 +1,9 @@
 #pragma once
 #include "MemoryConstants.h"
+#include "VMPhaseTiming.h"
+#include "VMPolicy.h"
+#include "VMStats.h"
+#include <stddef.h>
 // #include "Test/MemoryConstants_test1.h"
  // #include "Test/MemoryConstants_test2.h"
 
@@ -8,6 +12,73 @@
  */
 void VMinitialize();
 
+/*
+ * Initialize the virtual memory, storing evicted pages in a memory mapped
+ * swap file at the given path (or in process memory if path is NULL).
+ *
+ * returns 1 on success.
+ * returns 0 if the swap file could not be created or mapped, in which case
+ * the virtual memory is initialized with the in-memory swap.
+ */
+int VMinitializeWithSwapFile(const char* path);
+
+/*
+ * Initialize the virtual memory, evicting pages by the given policy from now
+ * on. VMinitialize and VMinitializeWithSwapFile keep the policy selected last
+ * (VM_POLICY_CYCLIC_DISTANCE if none was).
+ *
+ * returns 1 on success.
+ * returns 0 if the policy is unknown, in which case nothing changes.
+ */
+int VMinitializeWithPolicy(VMReplacementPolicy policy);
+
+/*
+ * Initialize the virtual memory with a background thread that evicts pages
+ * ahead of demand. once all frames were used, the thread refills a pool of
+ * free frames to twice lowWatermark whenever fewer than lowWatermark are
+ * left, so that most faults find a free frame instead of evicting a page
+ * themselves. evicted pages are written to swap without blocking other
+ * accesses. VMinitialize and the other initialize functions keep the
+ * watermark selected last. 0, the default, stops the thread.
+ *
+ * returns 1 on success.
+ * returns 0 if lowWatermark is more than a quarter of the frames or the
+ * library was built without VM_CONCURRENT, in which case nothing changes.
+ */
+int VMinitializeWithReclaimer(size_t lowWatermark);
+
+/*
+ * Initialize the virtual memory with count huge pages. a huge page maps a
+ * whole region of PAGE_SIZE pages to PAGE_SIZE contiguous frames from a
+ * single entry of the next to last level of tables, in place of a last level
+ * table, so accesses to it walk one level less and share a single TLB
+ * entry. the frames of the huge pages are reserved at the top of the RAM and
+ * every region is mapped by one of them; the other frames only hold tables.
+ * when all huge pages are in use, the one whose region is at maximal cyclic
+ * distance is evicted, each of its pages through PMevict, and the pages of a
+ * region are restored through PMrestore when it is mapped again.
+ * VMinitialize and the other initialize functions keep the count selected
+ * last. 0, the default, maps every page by itself.
+ *
+ * returns 1 on success.
+ * returns 0 if the geometry has no room for count huge pages next to the
+ * tables they need, in which case nothing changes.
+ */
+int VMinitializeWithHugePages(size_t count);
+
+/*
+ * turns readahead on for faults that continue a stream of faults a fixed
+ * number of pages apart (one for a sequential scan): the following pages of
+ * the stream are mapped in one batch before they are referenced. the batch
+ * grows up to maxPages (at most a quarter of the frames) while its pages get
+ * used and shrinks when they are evicted unused. 0, the default, turns
+ * readahead off.
+ *
+ * readahead changes which pages are resident, so it also changes the pages
+ * evicted. the setting is kept across VMinitialize.
+ */
+void VMsetReadahead(size_t maxPages);
+
 /* reads a word from the given virtual address
  * and puts its content in *value.
  *
@@ -26,4 +97,77 @@ int VMread(uint64_t virtualAddress, word_t* value);
 
 int VMwrite(uint64_t virtualAddress, word_t value);
 
+/* reads count consecutive words, starting at the given virtual address,
+ * into buf.
+ *
+ * returns 1 on success.
+ * returns 0 on failure (if any address in the range cannot be mapped to a
+ * physical address), in which case nothing is read
+ */
+int VMreadRange(uint64_t virtualAddress, word_t* buf, size_t count);
 
+/* writes count consecutive words from buf, starting at the given virtual
+ * address.
+ *
+ * returns 1 on success.
+ * returns 0 on failure (if any address in the range cannot be mapped to a
+ * physical address), in which case nothing is written
+ */
+int VMwriteRange(uint64_t virtualAddress, const word_t* buf, size_t count);
+
+/* copies the current paging statistics into *stats
+ */
+void VMgetStats(VMStats* stats);
+
+/*
+ * writes the current paging statistics to the file at the given path as a
+ * JSON object, see writeStatsJson in VMStats.h
+ *
+ * returns 1 on success.
+ * returns 0 if the file could not be written.
+ */
+int VMdumpStats(const char* path);
+
+/* copies the latency histograms of the phases of the fault path, see
+ * VMPhaseTiming.h, into *timing. they are empty unless the library was built
+ * with VM_PHASE_TIMING.
+ */
+void VMgetPhaseTiming(VMPhaseTiming* timing);
+
+/*
+ * writes the count and percentiles of every phase of the fault path to the
+ * file at the given path as a JSON object, see writePhaseTimingJson in
+ * VMPhaseTiming.h
+ *
+ * returns 1 on success.
+ * returns 0 if the file could not be written.
+ */
+int VMdumpPhaseTiming(const char* path);
+
+/*
+ * starts recording every VMread, VMwrite, VMreadRange and VMwriteRange call
+ * to a binary trace at the given path (see AccessTrace.h), which
+ * Test/replay_trace.cpp feeds back through a virtual memory. every call is
+ * recorded with its address and whether it failed; VMread and VMwrite with
+ * the word read or written, ranges with their length, and VMwriteRange also
+ * with the words it wrote, while the words VMreadRange read are not kept.
+ * with timestamps set, every call also records when it returned. a
+ * recording in progress is stopped first.
+ *
+ * this and VMstopRecording must not be called concurrently with any other
+ * VM* function.
+ *
+ * returns 1 on success.
+ * returns 0 if the file could not be created, in which case nothing is
+ * recorded.
+ */
+int VMstartRecording(const char* path, int timestamps);
+
+/*
+ * stops recording and writes out the rest of the trace.
+ *
+ * returns 1 on success.
+ * returns 0 if nothing was being recorded or the trace could not be written
+ * completely.
+ */
+int VMstopRecording();
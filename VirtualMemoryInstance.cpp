@@ -0,0 +1,1605 @@
+#include "VirtualMemoryInstance.h"
+
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <new>
+
+#ifdef VM_PHASE_TIMING
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+// definitions
+#define INITIAL_FRAME_VALUE 0
+#define START_FRAME 0
+#define BITMAP_WORDS(BITS) (((BITS) + 63) / 64)
+// marks a table entry that maps a huge page. only tested with huge pages
+// on, as without them a frame index may have this bit set
+#define HUGE_ENTRY ((word_t) 1 << (sizeof (word_t) * 8 - 2))
+
+// TLB geometry, may be overridden at compile time.
+// TLB_SETS must be a power of two.
+#ifndef TLB_SETS
+#define TLB_SETS 16
+#endif
+#ifndef TLB_WAYS
+#define TLB_WAYS 4
+#endif
+#ifndef HUGE_TLB_ENTRIES
+#define HUGE_TLB_ENTRIES 4
+#endif
+// paging structure cache entries per table level, a power of two
+#ifndef PSC_ENTRIES
+#define PSC_ENTRIES 8
+#endif
+
+// number of locks that faults are spread over in the concurrent build
+#ifndef FAULT_SHARDS
+#define FAULT_SHARDS 16
+#endif
+
+// times a read retries without locks before taking table_lock
+#ifndef OPTIMISTIC_READ_ATTEMPTS
+#define OPTIMISTIC_READ_ATTEMPTS 4
+#endif
+
+// pages in the first readahead batch of a stream
+#ifndef READAHEAD_INITIAL_WINDOW
+#define READAHEAD_INITIAL_WINDOW 4
+#endif
+
+// the geometries that get a constant folded specialization: NORMAL, TEST,
+// OFFSET_DIFFERENT, SINGLE_TABLE, UNREACHABLE and NO_EVICTION
+#define PREBUILT_GEOMETRIES(X) \
+  X (4, 10, 20)                \
+  X (1, 4, 5)                  \
+  X (2, 5, 7)                  \
+  X (5, 6, 10)                 \
+  X (3, 9, 6)                  \
+  X (5, 5, 5)
+
+// lets GCC fully unroll the table walk when the depth is a constant
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8
+#define UNROLL_TABLE_WALK _Pragma ("GCC unroll 8")
+#else
+#define UNROLL_TABLE_WALK
+#endif
+
+#ifdef VM_PHASE_TIMING
+// phases are timed with the time stamp counter where there is one, which is
+// about half as expensive to read as steady_clock, and in nanoseconds of
+// steady_clock elsewhere
+static inline uint64_t phase_clock ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc ();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds> (
+      std::chrono::steady_clock::now ().time_since_epoch ()).count ();
+#endif
+}
+
+// nanoseconds per tick of phase_clock, measured once against steady_clock
+static double phase_clock_period ()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  static const double period = [] {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now ();
+    uint64_t first = phase_clock ();
+    std::chrono::steady_clock::duration elapsed;
+    do
+      elapsed = std::chrono::steady_clock::now () - start;
+    while (elapsed < std::chrono::milliseconds (2));
+    uint64_t ticks = phase_clock () - first;
+    return std::chrono::duration<double, std::nano> (elapsed).count ()
+           / (double) (ticks != 0 ? ticks : 1);
+  } ();
+  return period;
+#else
+  return 1.0;
+#endif
+}
+
+// adds the time from its construction to its destruction to the histogram
+// of a phase
+class phase_timer
+{
+ public:
+  phase_timer (VMPhaseTiming *timing, VMPhase phase)
+      : histogram (timing->buckets[phase]), start (phase_clock ())
+  {}
+
+  ~phase_timer ()
+  {
+    uint64_t elapsed =
+        (uint64_t) ((double) (phase_clock () - start) * phase_clock_period ());
+    countEvent (&histogram[phaseTimingBucket (elapsed)]);
+  }
+
+ private:
+  uint64_t *histogram;
+  uint64_t start;
+};
+
+// times the rest of the enclosing scope as PHASE
+#define TIME_PHASE(PHASE) phase_timer phase_timer_ (phase_times.get (), PHASE)
+#else
+#define TIME_PHASE(PHASE)
+#endif
+
+template <class Geometry>
+static bool geometry_matches (const Geometry &geo,
+                              const MemoryGeometry &geometry)
+{
+  return geo.offsetWidth == geometry.offsetWidth
+         && geo.physicalAddressWidth == geometry.physicalAddressWidth
+         && geo.virtualAddressWidth == geometry.virtualAddressWidth;
+}
+
+template <class Geometry>
+BasicVirtualMemory<Geometry>::BasicVirtualMemory (const MemoryGeometry &geometry)
+    : owned_pm (new PhysicalMemory (geometry)), pm (*owned_pm),
+      geo (geometry), fault_shards (new Mutex[FAULT_SHARDS]),
+      tlb_sets (new tlb_set[TLB_SETS]),
+      policy (create_replacement_policy (VM_POLICY_CYCLIC_DISTANCE)),
+      policy_kind (VM_POLICY_CYCLIC_DISTANCE), huge_page_count (0),
+      readahead_max (0),
+      reclaim_low (0), reclaim_hint (0)
+{
+  assert(geometry_matches (geo, geometry));
+  reset_state ();
+}
+
+template <class Geometry>
+BasicVirtualMemory<Geometry>::BasicVirtualMemory (
+    PhysicalMemory &physical_memory)
+    : pm (physical_memory), geo (physical_memory.geometry ()),
+      fault_shards (new Mutex[FAULT_SHARDS]),
+      tlb_sets (new tlb_set[TLB_SETS]),
+      policy (create_replacement_policy (VM_POLICY_CYCLIC_DISTANCE)),
+      policy_kind (VM_POLICY_CYCLIC_DISTANCE), huge_page_count (0),
+      readahead_max (0),
+      reclaim_low (0), reclaim_hint (0)
+{
+  assert(geometry_matches (geo, physical_memory.geometry ()));
+  reset_state ();
+}
+
+template <class Geometry>
+BasicVirtualMemory<Geometry>::~BasicVirtualMemory ()
+{
+  stop_reclaimer ();
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::reset_state ()
+{
+  tlb.assign (TLB_SETS * TLB_WAYS, tlb_entry ());
+  for (int i = 0; i < TLB_SETS; ++i)
+  {
+    tlb_sets[i].clock = 0;
+    tlb_sets[i].stats = VMStats ();
+  }
+  huge_tlb.assign (HUGE_TLB_ENTRIES, tlb_entry ());
+  huge_tlb_clock = 0;
+  // the prefix of the deepest cached level has virtualAddressWidth - 2 *
+  // offsetWidth bits
+  psc_enabled = geo.tablesDepth >= 2
+                && geo.virtualAddressWidth - 2 * geo.offsetWidth <= 32;
+  psc.assign (psc_enabled ? geo.tablesDepth * PSC_ENTRIES : 0, 0);
+  pm.resetAccessCounts ();
+#ifdef VM_PHASE_TIMING
+  phase_times.reset (new VMPhaseTiming ());
+  phase_clock_period ();
+#endif
+  reverse_map.assign (geo.numFrames, frame_link ());
+  frame_limit = (word_t) (geo.numFrames - huge_page_count * geo.pageSize);
+  huge_pages.assign (huge_page_count, huge_page ());
+  next_unused_frame = START_FRAME + 1;
+  table_entries.assign (geo.numFrames, 0);
+  empty_tables.assign (BITMAP_WORDS (geo.numFrames), 0);
+  swapped_pages.assign (BITMAP_WORDS (geo.numPages), 0);
+  dirty_frames.assign (geo.numFrames, 0);
+  prefetched_frames.assign (geo.numFrames, 0);
+  readahead_wasted = 0;
+  stream = readahead_state ();
+  stream.window = std::min<size_t> (READAHEAD_INITIAL_WINDOW, readahead_max);
+  free_frames.clear ();
+  reclaim_hint = 0;
+#ifdef VM_CONCURRENT
+  writeback_pages.assign (BITMAP_WORDS (geo.numPages), 0);
+  reclaim_requested = false;
+#endif
+  policy->reset (geo.numFrames, geo.numPages);
+  policy_tracks_accesses = policy->tracks_accesses ();
+}
+
+template <class Geometry>
+bool BasicVirtualMemory<Geometry>::is_address_legal (uint64_t virtual_address) const
+{
+  if (virtual_address >= geo.virtualMemorySize
+      || (uint64_t) geo.tablesDepth >= geo.numFrames)
+  {
+    return false;
+  }
+  return true;
+}
+
+template <class Geometry>
+bool BasicVirtualMemory<Geometry>::is_range_legal (uint64_t virtual_address,
+                                                   size_t count) const
+{
+  return is_address_legal (virtual_address)
+         && count <= geo.virtualMemorySize - virtual_address;
+}
+
+// Helper Functions
+template <class Geometry>
+uint64_t BasicVirtualMemory<Geometry>::calculate_cyclic_distance (
+    uint64_t in_page, uint64_t ref_page) const
+{
+  uint64_t abs_diff = in_page > ref_page ? in_page - ref_page
+                                         : ref_page - in_page;
+  if (geo.numPages - abs_diff < abs_diff)
+  {
+    return geo.numPages - abs_diff;
+  }
+  return abs_diff;
+}
+
+// TLB
+template <class Geometry>
+bool BasicVirtualMemory<Geometry>::tlb_lookup (uint64_t page, word_t *frame)
+{
+  tlb_set &state = tlb_sets[page & (TLB_SETS - 1)];
+  // with huge pages every page is in one, so only the huge TLB is used
+  if (huge_page_count != 0)
+  {
+    uint64_t region = page >> geo.offsetWidth;
+    std::lock_guard<SpinLock> hold (huge_tlb_lock);
+    for (int i = 0; i < HUGE_TLB_ENTRIES; ++i)
+    {
+      if (huge_tlb[i].valid && huge_tlb[i].page == region)
+      {
+        huge_tlb[i].last_used = ++huge_tlb_clock;
+        *frame = huge_tlb[i].frame + (word_t) (page & (geo.pageSize - 1));
+        countEvent (&state.stats.tlb_hits);
+        return true;
+      }
+    }
+    countEvent (&state.stats.tlb_misses);
+    return false;
+  }
+
+  tlb_entry *set = &tlb[(page & (TLB_SETS - 1)) * TLB_WAYS];
+  std::lock_guard<SpinLock> hold (state.lock);
+  for (int way = 0; way < TLB_WAYS; ++way)
+  {
+    if (set[way].valid && set[way].page == page)
+    {
+      set[way].last_used = ++state.clock;
+      *frame = set[way].frame;
+      countEvent (&state.stats.tlb_hits);
+      return true;
+    }
+  }
+  countEvent (&state.stats.tlb_misses);
+  return false;
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::tlb_insert (uint64_t page, word_t frame)
+{
+  // a huge page takes a single entry for its whole region
+  if (frame >= frame_limit)
+  {
+    std::lock_guard<SpinLock> hold (huge_tlb_lock);
+    tlb_entry *victim = &huge_tlb[0];
+    for (size_t i = 0; i < huge_tlb.size (); ++i)
+    {
+      if (!huge_tlb[i].valid)
+      {
+        victim = &huge_tlb[i];
+        break;
+      }
+      if (huge_tlb[i].last_used < victim->last_used)
+        victim = &huge_tlb[i];
+    }
+    victim->page = page >> geo.offsetWidth;
+    victim->frame = frame - (word_t) (page & (geo.pageSize - 1));
+    victim->last_used = ++huge_tlb_clock;
+    victim->valid = true;
+    return;
+  }
+
+  tlb_set &state = tlb_sets[page & (TLB_SETS - 1)];
+  tlb_entry *set = &tlb[(page & (TLB_SETS - 1)) * TLB_WAYS];
+  std::lock_guard<SpinLock> hold (state.lock);
+  tlb_entry *victim = &set[0];
+  for (int way = 0; way < TLB_WAYS; ++way)
+  {
+    if (!set[way].valid)
+    {
+      victim = &set[way];
+      break;
+    }
+    if (set[way].last_used < victim->last_used)
+      victim = &set[way];
+  }
+  victim->page = page;
+  victim->frame = frame;
+  victim->last_used = ++state.clock;
+  victim->valid = true;
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::tlb_invalidate_page (uint64_t page)
+{
+  tlb_entry *set = &tlb[(page & (TLB_SETS - 1)) * TLB_WAYS];
+  for (int way = 0; way < TLB_WAYS; ++way)
+  {
+    if (set[way].valid && set[way].page == page)
+      set[way].valid = false;
+  }
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::tlb_invalidate_region (uint64_t region)
+{
+  for (size_t i = 0; i < huge_tlb.size (); ++i)
+  {
+    if (huge_tlb[i].valid && huge_tlb[i].page == region)
+      huge_tlb[i].valid = false;
+  }
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::tlb_flush ()
+{
+  for (size_t i = 0; i < tlb.size (); ++i)
+    tlb[i].valid = false;
+  for (size_t i = 0; i < huge_tlb.size (); ++i)
+    huge_tlb[i].valid = false;
+  huge_tlb_clock = 0;
+  for (int i = 0; i < TLB_SETS; ++i)
+    tlb_sets[i].clock = 0;
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::note_access (uint64_t page, word_t frame)
+{
+  if (policy_tracks_accesses && frame < frame_limit)
+  {
+    policy->on_access (page, frame);
+  }
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::mark_dirty (word_t frame)
+{
+  // avoid dirtying the line when the flag is already set
+  if (!loadShared (&dirty_frames[frame]))
+  {
+    storeShared (&dirty_frames[frame], uint8_t (1));
+  }
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::count_event (uint64_t page,
+                                                uint64_t VMStats::*counter,
+                                                uint64_t amount)
+{
+  countEvent (&(tlb_sets[page & (TLB_SETS - 1)].stats.*counter), amount);
+}
+
+// finds the deepest table of the walk of page in the paging structure cache.
+// returns its level and sets frame to it, or returns 0 if there is none.
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::psc_lookup (uint64_t page, word_t *frame)
+{
+  if (!psc_enabled)
+  {
+    return 0;
+  }
+  for (int level = geo.tablesDepth - 1; level > 0; --level)
+  {
+    uint64_t prefix = page >> ((geo.tablesDepth - level) * geo.offsetWidth);
+    uint64_t entry = loadShared (
+        &psc[level * PSC_ENTRIES + (prefix & (PSC_ENTRIES - 1))]);
+    if ((uint32_t) entry != 0 && entry >> 32 == prefix)
+    {
+      *frame = (word_t) (uint32_t) entry;
+      return level;
+    }
+  }
+  return 0;
+}
+
+// caches frame as the table of the given level in the walk of page
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::psc_insert (int level, uint64_t page,
+                                               word_t frame)
+{
+  if (!psc_enabled)
+  {
+    return;
+  }
+  uint64_t prefix = page >> ((geo.tablesDepth - level) * geo.offsetWidth);
+  uint64_t *entry = &psc[level * PSC_ENTRIES + (prefix & (PSC_ENTRIES - 1))];
+  uint64_t value = prefix << 32 | (uint32_t) frame;
+  if (loadShared (entry) != value)
+  {
+    storeShared (entry, value);
+  }
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::psc_invalidate (int level, uint64_t prefix)
+{
+  if (!psc_enabled)
+  {
+    return;
+  }
+  uint64_t *entry = &psc[level * PSC_ENTRIES + (prefix & (PSC_ENTRIES - 1))];
+  if (loadShared (entry) >> 32 == prefix)
+  {
+    storeShared (entry, uint64_t (0));
+  }
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::clear_frame (word_t frame)
+{
+  TIME_PHASE (VM_PHASE_CLEAR_FRAME);
+  pm.zeroFrame (frame);
+  count_event (frame, &VMStats::frames_cleared);
+  table_entries[frame] = 0;
+  if (frame != START_FRAME)
+    mark_table_empty (frame, true);
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::process_leaf (word_t frame, uint64_t page,
+                                                 uint64_t path,
+                                                 dfs_result *result)
+{
+  if (frame > result->max_frame_taken)
+    result->max_frame_taken = frame;
+
+  word_t cyclic_dist = (word_t) calculate_cyclic_distance (page, path);
+  if (cyclic_dist > result->max_cyclic_dist)
+  {
+    result->max_cyclic_dist = cyclic_dist;
+    result->max_cyclic_page = (word_t) path;
+    result->max_cyclic_frame = frame;
+  }
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::dfs (int level, uint64_t page, word_t frame,
+                                        uint64_t parent, dfs_result *result,
+                                        uint64_t path)
+{
+  count_event (page, &VMStats::dfs_nodes);
+  if (level == geo.tablesDepth)
+  {
+    process_leaf (frame, page, path, result);
+    return;
+  }
+
+  uint64_t empty_childs = 0;
+  for (uint64_t i = 0; i < geo.pageSize; ++i)
+  {
+    word_t child;
+    pm.read (frame * geo.pageSize + i, &child);
+    if (child == 0)
+    {
+      empty_childs++;
+      continue;
+    }
+    if (huge_page_count != 0 && (child & HUGE_ENTRY))
+      continue;
+
+    dfs (level + 1, page, child, parent, result,
+         (path << geo.offsetWidth) + i);
+  }
+
+  if (empty_childs == geo.pageSize && frame != (word_t) parent
+      && frame < result->empty_frame)
+  {
+    result->empty_frame = frame;
+  }
+
+  if (frame > result->max_frame_taken)
+    result->max_frame_taken = frame;
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::link_frame (word_t frame,
+                                               word_t parent_frame,
+                                               uint64_t entry_index,
+                                               int level, uint64_t page)
+{
+  if (level == geo.tablesDepth)
+  {
+    storeShared (&dirty_frames[frame], uint8_t (0));
+    storeShared (&prefetched_frames[frame], uint8_t (0));
+  }
+  pm.write (parent_frame * geo.pageSize + entry_index, frame);
+  if (table_entries[parent_frame]++ == 0)
+    mark_table_empty (parent_frame, false);
+  reverse_map[frame].parent_frame = parent_frame;
+  reverse_map[frame].entry_index = entry_index;
+  reverse_map[frame].level = level;
+  reverse_map[frame].page = page;
+  reverse_map[frame].linked = true;
+  if (level == geo.tablesDepth)
+    policy->on_map (page, frame);
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::remove_frame (word_t target_frame)
+{
+  TIME_PHASE (VM_PHASE_REMOVE_FRAME);
+  frame_link *link = &reverse_map[target_frame];
+  if (!link->linked) return;
+
+  if (link->level == geo.tablesDepth)
+  {
+    tlb_invalidate_page (link->page);
+    policy->on_unmap (link->page, target_frame);
+  }
+  else
+  {
+    psc_invalidate (link->level, link->page);
+  }
+  pm.write (link->parent_frame * geo.pageSize + link->entry_index,
+            INITIAL_FRAME_VALUE);
+  if (--table_entries[link->parent_frame] == 0
+      && link->parent_frame != START_FRAME)
+    mark_table_empty (link->parent_frame, true);
+  link->linked = false;
+  mark_table_empty (target_frame, false);
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::mark_table_empty (word_t frame, bool empty)
+{
+  uint64_t bit = 1ull << (frame % 64);
+  if (empty)
+    empty_tables[frame / 64] |= bit;
+  else
+    empty_tables[frame / 64] &= ~bit;
+}
+
+// returns the lowest empty table frame other than parent, or numFrames
+template <class Geometry>
+word_t BasicVirtualMemory<Geometry>::find_empty_table (word_t parent)
+{
+  for (size_t i = 0; i < empty_tables.size (); ++i)
+  {
+    uint64_t bits = empty_tables[i];
+    if ((size_t) parent / 64 == i)
+      bits &= ~(1ull << (parent % 64));
+    if (bits != 0)
+      return (word_t) (i * 64 + __builtin_ctzll (bits));
+  }
+  return (word_t) geo.numFrames;
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::set_page_swapped (uint64_t page, bool swapped)
+{
+  uint64_t bit = 1ull << (page % 64);
+  if (swapped)
+    swapped_pages[page / 64] |= bit;
+  else
+    swapped_pages[page / 64] &= ~bit;
+}
+
+template <class Geometry>
+bool BasicVirtualMemory<Geometry>::is_page_swapped (uint64_t page) const
+{
+  return (swapped_pages[page / 64] >> (page % 64)) & 1;
+}
+
+template <class Geometry>
+word_t BasicVirtualMemory<Geometry>::locate_available_frame (uint64_t parent, uint64_t page)
+{
+  TIME_PHASE (VM_PHASE_LOCATE_FRAME);
+#ifdef VM_VERIFY
+  dfs_result expected = {0, 0, 0, 0, (word_t) geo.numFrames};
+  {
+    TIME_PHASE (VM_PHASE_DFS);
+    dfs (0, page, 0, parent, &expected, 0);
+  }
+#endif
+
+  word_t empty_frame = find_empty_table ((word_t) parent);
+#ifdef VM_VERIFY
+  assert(empty_frame == expected.empty_frame);
+#endif
+  if ((uint64_t) empty_frame != geo.numFrames)
+  {
+    remove_frame (empty_frame);
+    return empty_frame;
+  }
+#ifdef VM_VERIFY
+  // the dfs does not see the frames the reclaimer holds
+  assert(reclaim_low != 0
+         || next_unused_frame == expected.max_frame_taken + 1);
+#endif
+  if (next_unused_frame < frame_limit)
+  {
+    return next_unused_frame++;
+  }
+
+  word_t frame;
+  {
+    std::lock_guard<Mutex> hold (alloc_lock);
+    frame = take_free_frame (page);
+  }
+  if (frame != 0)
+  {
+    return frame;
+  }
+
+  word_t victim = policy->choose_victim (page);
+#ifdef VM_VERIFY
+  assert(policy_kind != VM_POLICY_CYCLIC_DISTANCE
+         || victim == expected.max_cyclic_frame);
+#endif
+  write_back (victim);
+  release_victim (victim);
+  count_event (reverse_map[victim].page, &VMStats::direct_evictions);
+  return victim;
+}
+
+// takes a frame from the reclaimer's pool, asking for a refill if it runs
+// low. returns 0 if the pool is empty. alloc_lock must be held.
+template <class Geometry>
+word_t BasicVirtualMemory<Geometry>::take_free_frame (uint64_t page)
+{
+  if (reclaim_low == 0)
+  {
+    return 0;
+  }
+  reclaim_hint = page;
+  word_t frame = 0;
+  if (!free_frames.empty ())
+  {
+    frame = free_frames.back ();
+    free_frames.pop_back ();
+  }
+#ifdef VM_CONCURRENT
+  if (free_frames.size () < reclaim_low)
+  {
+    std::lock_guard<std::mutex> hold (reclaim_mutex);
+    if (!reclaim_requested)
+    {
+      reclaim_requested = true;
+      reclaim_wakeup.notify_one ();
+    }
+  }
+#endif
+  return frame;
+}
+
+// copies the page in victim to swap, unless swap has a clean copy of it
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::write_back (word_t victim)
+{
+  evict_page (victim, reverse_map[victim].page,
+              loadShared (&dirty_frames[victim]) != 0);
+}
+
+// evicts page from frame, writing it to swap only if it is dirty
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::evict_page (word_t frame, uint64_t page,
+                                               bool dirty)
+{
+  TIME_PHASE (VM_PHASE_EVICT);
+  if (!pm.evict (frame, page, dirty))
+  {
+    count_event (page, &VMStats::clean_evictions);
+  }
+}
+
+// restores page from swap into frame, once the reclaimer finished writing
+// it there
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::restore_page (word_t frame, uint64_t page)
+{
+  TIME_PHASE (VM_PHASE_RESTORE);
+  wait_for_writeback (page);
+  pm.restore (frame, page);
+  count_event (page, &VMStats::restores);
+  set_page_swapped (page, false);
+}
+
+// unlinks the page in victim, which from now on has to be restored
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::release_victim (word_t victim)
+{
+  if (loadShared (&prefetched_frames[victim]))
+  {
+    count_event (reverse_map[victim].page, &VMStats::prefetch_wasted);
+    storeShared (&readahead_wasted, uint8_t (1));
+  }
+  set_page_swapped (reverse_map[victim].page, true);
+  remove_frame (victim);
+}
+
+// waits until the reclaimer finished writing page to swap, if it is doing so
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::wait_for_writeback (uint64_t page)
+{
+#ifdef VM_CONCURRENT
+  if (reclaim_low == 0)
+  {
+    return;
+  }
+  std::unique_lock<std::mutex> hold (reclaim_mutex);
+  while ((writeback_pages[page / 64] >> (page % 64)) & 1)
+  {
+    writeback_done.wait (hold);
+  }
+#else
+  (void) page;
+#endif
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::start_reclaimer ()
+{
+#ifdef VM_CONCURRENT
+  if (reclaim_low == 0)
+  {
+    return;
+  }
+  reclaim_stop = false;
+  reclaimer = std::thread (&BasicVirtualMemory::reclaim_loop, this);
+#endif
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::stop_reclaimer ()
+{
+#ifdef VM_CONCURRENT
+  if (!reclaimer.joinable ())
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> hold (reclaim_mutex);
+    reclaim_stop = true;
+    reclaim_wakeup.notify_one ();
+  }
+  reclaimer.join ();
+#endif
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::reclaim_loop ()
+{
+#ifdef VM_CONCURRENT
+  std::unique_lock<std::mutex> hold (reclaim_mutex);
+  for (;;)
+  {
+    while (!reclaim_requested && !reclaim_stop)
+    {
+      reclaim_wakeup.wait (hold);
+    }
+    if (reclaim_stop)
+    {
+      return;
+    }
+    hold.unlock ();
+    reclaim ();
+    hold.lock ();
+    reclaim_requested = false;
+  }
+#endif
+}
+
+// refills the pool to twice reclaim_low frames. the victims are unlinked
+// holding table_lock exclusively, as a faulting eviction would, but written
+// back after releasing it, so that the copies overlap with other accesses.
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::reclaim ()
+{
+#ifdef VM_CONCURRENT
+  std::vector<writeback> batch;
+  {
+    std::lock_guard<RwLock> hold (table_lock);
+    std::lock_guard<std::mutex> marks (reclaim_mutex);
+    // nothing else adds to the pool, and faults taking from it are excluded
+    while (free_frames.size () + batch.size () < 2 * reclaim_low)
+    {
+      word_t victim = policy->choose_victim (reclaim_hint);
+      if (victim == 0) break;
+      writeback entry = {victim, reverse_map[victim].page,
+                         loadShared (&dirty_frames[victim]) != 0};
+      release_victim (victim);
+      writeback_pages[entry.page / 64] |= 1ull << (entry.page % 64);
+      count_event (entry.page, &VMStats::background_evictions);
+      batch.push_back (entry);
+    }
+  }
+
+  // the frames are linked nowhere, so nothing else touches them meanwhile
+  for (size_t i = 0; i < batch.size (); ++i)
+  {
+    evict_page (batch[i].frame, batch[i].page, batch[i].dirty);
+  }
+  {
+    std::lock_guard<Mutex> hold (alloc_lock);
+    for (size_t i = 0; i < batch.size (); ++i)
+      free_frames.push_back (batch[i].frame);
+  }
+  std::lock_guard<std::mutex> hold (reclaim_mutex);
+  for (size_t i = 0; i < batch.size (); ++i)
+  {
+    writeback_pages[batch[i].page / 64] &= ~(1ull << (batch[i].page % 64));
+  }
+  writeback_done.notify_all ();
+#endif
+}
+
+// maps the region of page to a huge page linked at entry_index of parent,
+// evicting another huge page if none is free, and restores the pages of the
+// region that are in swap. returns the frame of page.
+template <class Geometry>
+word_t BasicVirtualMemory<Geometry>::map_huge_page (word_t parent,
+                                                    uint64_t entry_index,
+                                                    uint64_t page,
+                                                    bool *restored)
+{
+  uint64_t region = page >> geo.offsetWidth;
+  uint64_t regions = geo.numPages >> geo.offsetWidth;
+  size_t block = 0;
+  uint64_t max_dist = 0;
+  for (size_t i = 0; i < huge_pages.size (); ++i)
+  {
+    if (!huge_pages[i].mapped)
+    {
+      block = i;
+      break;
+    }
+    uint64_t dist = huge_pages[i].region > region
+                    ? huge_pages[i].region - region
+                    : region - huge_pages[i].region;
+    dist = std::min (dist, regions - dist);
+    if (dist > max_dist)
+    {
+      max_dist = dist;
+      block = i;
+    }
+  }
+  if (huge_pages[block].mapped)
+  {
+    evict_huge_page (block);
+  }
+
+  word_t first = frame_limit + (word_t) (block * geo.pageSize);
+  *restored = false;
+  for (uint64_t i = 0; i < geo.pageSize; ++i)
+  {
+    uint64_t restored_page = (region << geo.offsetWidth) + i;
+    storeShared (&dirty_frames[first + i], uint8_t (0));
+    storeShared (&prefetched_frames[first + i], uint8_t (0));
+    if (is_page_swapped (restored_page))
+    {
+      restore_page (first + i, restored_page);
+      *restored = true;
+    }
+#ifdef VM_CONCURRENT
+    else
+    {
+      pm.materialize (first + i);
+    }
+#endif
+  }
+
+  pm.write (parent * geo.pageSize + entry_index, first | HUGE_ENTRY);
+  if (table_entries[parent]++ == 0)
+    mark_table_empty (parent, false);
+  huge_pages[block].region = region;
+  huge_pages[block].parent_frame = parent;
+  huge_pages[block].entry_index = entry_index;
+  huge_pages[block].mapped = true;
+  count_event (page, &VMStats::huge_faults);
+  return first + (word_t) (page & (geo.pageSize - 1));
+}
+
+// evicts every page of a huge page and unlinks it
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::evict_huge_page (size_t block)
+{
+  huge_page &evicted = huge_pages[block];
+  word_t first = frame_limit + (word_t) (block * geo.pageSize);
+  for (uint64_t i = 0; i < geo.pageSize; ++i)
+  {
+    uint64_t evicted_page = (evicted.region << geo.offsetWidth) + i;
+    evict_page (first + i, evicted_page,
+                loadShared (&dirty_frames[first + i]) != 0);
+    set_page_swapped (evicted_page, true);
+  }
+  tlb_invalidate_region (evicted.region);
+  pm.write (evicted.parent_frame * geo.pageSize + evicted.entry_index,
+            INITIAL_FRAME_VALUE);
+  if (--table_entries[evicted.parent_frame] == 0
+      && evicted.parent_frame != START_FRAME)
+    mark_table_empty (evicted.parent_frame, true);
+  evicted.mapped = false;
+  count_event (evicted.region << geo.offsetWidth, &VMStats::huge_evictions);
+}
+
+// links a never used or reclaimed frame below parent without touching any
+// other part of the page table, as a fault does while holding table_lock
+// shared. returns 0 if the fault has to reuse a frame or restore the page
+// instead.
+template <class Geometry>
+word_t BasicVirtualMemory<Geometry>::link_fresh_frame (word_t parent,
+                                                       uint64_t entry_index,
+                                                       int level,
+                                                       uint64_t page)
+{
+  std::lock_guard<Mutex> hold (alloc_lock);
+  bool leaf = level == geo.tablesDepth - 1;
+  if ((uint64_t) find_empty_table (parent) != geo.numFrames
+      || (leaf && is_page_swapped (page)))
+  {
+    return 0;
+  }
+
+  word_t frame;
+  if (next_unused_frame < frame_limit)
+    frame = next_unused_frame++;
+  else if ((frame = take_free_frame (page)) == 0)
+    return 0;
+  if (leaf)
+    pm.materialize (frame);
+  else
+    clear_frame (frame);
+  link_frame (frame, parent, entry_index, level + 1,
+              page >> ((geo.tablesDepth - level - 1) * geo.offsetWidth));
+  return frame;
+}
+
+// walks the tables of virtual_address from the deepest one in the paging
+// structure cache, linking the missing ones and caching them, and sets
+// access to MINOR_FAULT if it linked any, or to MAJOR_FAULT if it mapped a
+// huge page and restored some of it. returns false if a fault could not be
+// handled without exclusive access.
+template <class Geometry>
+bool BasicVirtualMemory<Geometry>::walk_tables (uint64_t virtual_address,
+                                                bool exclusive, word_t *frame,
+                                                page_access *access)
+{
+  TIME_PHASE (VM_PHASE_WALK);
+  word_t next_address = 0;
+  word_t current_address = 0;
+  uint64_t page = virtual_address >> geo.offsetWidth;
+  uint64_t top_entry = virtual_address >> (geo.tablesDepth * geo.offsetWidth);
+  std::unique_lock<Mutex> shard (fault_shards[top_entry % FAULT_SHARDS],
+                                 std::defer_lock);
+  count_event (page, &VMStats::table_walks);
+  int first_level = psc_lookup (page, &current_address);
+  if (first_level != 0)
+  {
+    count_event (page, &VMStats::psc_hits);
+    count_event (page, &VMStats::psc_levels_skipped, first_level);
+  }
+
+  UNROLL_TABLE_WALK
+  for (int level = first_level; level < geo.tablesDepth; level++)
+  {
+    uint64_t offset =
+        (virtual_address >> ((geo.tablesDepth - level) * geo.offsetWidth))
+        & (geo.pageSize - 1);
+    pm.read (current_address * geo.pageSize + offset, &next_address);
+    if (huge_page_count != 0 && (next_address & HUGE_ENTRY))
+    {
+      *frame = (next_address & ~HUGE_ENTRY)
+               + (word_t) (page & (geo.pageSize - 1));
+      return true;
+    }
+    if (next_address == 0 && huge_page_count != 0
+        && level == geo.tablesDepth - 2)
+    {
+      if (!exclusive) return false;
+      bool restored;
+      *frame = map_huge_page (current_address, offset, page, &restored);
+      *access = restored ? MAJOR_FAULT : MINOR_FAULT;
+      return true;
+    }
+    if (next_address == 0 && exclusive)
+    {
+      *access = MINOR_FAULT;
+      next_address = locate_available_frame (current_address, page);
+      if (level < geo.tablesDepth - 1) clear_frame (next_address);
+      link_frame (next_address, current_address, offset, level + 1,
+                  page >> ((geo.tablesDepth - level - 1) * geo.offsetWidth));
+    }
+    else if (next_address == 0)
+    {
+      // another thread of the shard may have linked it in the meantime
+      if (!shard.owns_lock ())
+      {
+        shard.lock ();
+        pm.read (current_address * geo.pageSize + offset, &next_address);
+      }
+      if (next_address == 0)
+      {
+        *access = MINOR_FAULT;
+        next_address = link_fresh_frame (current_address, offset, level,
+                                         page);
+        if (next_address == 0) return false;
+      }
+    }
+    if (level < geo.tablesDepth - 1)
+      psc_insert (level + 1, page, next_address);
+    current_address = next_address;
+  }
+  *frame = current_address;
+  return true;
+}
+
+// maps the page of virtual_address into a frame, linking the missing tables
+// and restoring the page if it was evicted
+template <class Geometry>
+typename BasicVirtualMemory<Geometry>::page_access
+BasicVirtualMemory<Geometry>::map_page (uint64_t virtual_address,
+                                        RwLockGuard &guard, word_t *frame)
+{
+  TIME_PHASE (VM_PHASE_MAP_PAGE);
+  uint64_t page = virtual_address >> geo.offsetWidth;
+  page_access access = PAGE_HIT;
+  while (!walk_tables (virtual_address, guard.exclusive (), frame, &access))
+  {
+    guard.upgrade ();
+  }
+  if (access != MINOR_FAULT)
+  {
+    return access;
+  }
+  if (is_page_swapped (page))
+  {
+    restore_page (*frame, page);
+    return MAJOR_FAULT;
+  }
+#ifdef VM_CONCURRENT
+  // concurrent writers of the page must not race to clear its frame
+  pm.materialize (*frame);
+#endif
+  return MINOR_FAULT;
+}
+
+template <class Geometry>
+uint64_t BasicVirtualMemory<Geometry>::resolve_frame (uint64_t virtual_address,
+                                                      RwLockGuard &guard,
+                                                      page_access *access)
+{
+  word_t current_address = 0;
+  uint64_t page = virtual_address >> geo.offsetWidth;
+  uint64_t page_offset = virtual_address & (geo.pageSize - 1);
+
+  // prefetched pages only enter the TLB on their first reference
+  if (tlb_lookup (page, &current_address))
+  {
+    *access = PAGE_HIT;
+    count_event (page, &VMStats::page_hits);
+    note_access (page, current_address);
+    return current_address * geo.pageSize + page_offset;
+  }
+
+  *access = map_page (virtual_address, guard, &current_address);
+  switch (*access)
+  {
+    case PAGE_HIT:
+    case PREFETCHED_HIT:
+      if (readahead_max != 0
+          && loadShared (&prefetched_frames[current_address]))
+      {
+        storeShared (&prefetched_frames[current_address], uint8_t (0));
+        count_event (page, &VMStats::prefetch_hits);
+        *access = PREFETCHED_HIT;
+      }
+      count_event (page, &VMStats::page_hits);
+      note_access (page, current_address);
+      break;
+    case MINOR_FAULT:
+      count_event (page, &VMStats::minor_faults);
+      break;
+    case MAJOR_FAULT:
+      count_event (page, &VMStats::major_faults);
+      break;
+  }
+  tlb_insert (page, current_address);
+  return current_address * geo.pageSize + page_offset;
+}
+
+// follows the fault stream after a reference to page that faulted or was the
+// first to a prefetched page, prefetching the next batch of the stream when
+// it is due. must be called without holding table_lock.
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::readahead (uint64_t page,
+                                              page_access access)
+{
+  if (readahead_max == 0)
+  {
+    return;
+  }
+
+  uint64_t first_page;
+  int64_t stride;
+  size_t count = 0;
+  {
+    std::lock_guard<Mutex> hold (readahead_lock);
+    if (loadShared (&readahead_wasted))
+    {
+      storeShared (&readahead_wasted, uint8_t (0));
+      stream.window = std::max<size_t> (stream.window / 2, 1);
+    }
+
+    if (access == PREFETCHED_HIT)
+    {
+      // the stream reached its last batch in time, so the next one can be
+      // larger
+      if (!stream.streaming)
+        return;
+      stream.last_page = page;
+      if (page != stream.trigger_page)
+        return;
+      stream.window = std::min (stream.window * 2, readahead_max);
+    }
+    else
+    {
+      int64_t delta = (int64_t) (page - stream.last_page);
+      stream.last_page = page;
+      if (delta == 0 || delta != stream.stride)
+      {
+        stream.stride = delta;
+        stream.streaming = false;
+        return;
+      }
+      // a confirmed stream, or one whose prefetches did not keep up
+      stream.streaming = true;
+      stream.next_page = page + delta;
+    }
+
+    // the batch stops at either end of the address space
+    stride = stream.stride;
+    first_page = stream.next_page;
+    uint64_t available = 0;
+    if (first_page < geo.numPages)
+    {
+      available = 1 + (stride > 0
+                       ? (geo.numPages - 1 - first_page) / (uint64_t) stride
+                       : first_page / (uint64_t) -stride);
+    }
+    count = std::min<uint64_t> (stream.window, available);
+    stream.streaming = count == stream.window;
+    stream.trigger_page = first_page;
+    stream.next_page = first_page + count * stride;
+  }
+  prefetch (first_page, stride, count);
+}
+
+// maps count pages of a stream without referencing them, under a single hold
+// of table_lock
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::prefetch (uint64_t first_page,
+                                             int64_t stride, size_t count)
+{
+  if (count == 0)
+  {
+    return;
+  }
+  RwLockGuard guard (table_lock);
+  for (size_t i = 0; i < count; ++i)
+  {
+    uint64_t page = first_page + i * stride;
+    word_t frame;
+    // the first reference to a huge page may be a TLB hit, so huge pages
+    // are not tracked
+    if (map_page (page << geo.offsetWidth, guard, &frame) != PAGE_HIT
+        && frame < frame_limit)
+    {
+      storeShared (&prefetched_frames[frame], uint8_t (1));
+      count_event (page, &VMStats::prefetches);
+    }
+  }
+}
+
+// reads a resident page without taking any lock. frames are only unlinked or
+// reused while table_lock is held exclusively, so a walk that the lock's
+// sequence counter shows was not overlapped by such a section read the
+// current mapping. a walk that was overlapped may have followed a reused
+// frame, so its entries are only trusted after the bounds check and its
+// result only after validation. returns false if the page is not mapped, was
+// prefetched and not referenced yet, or the read kept being overlapped. the
+// walk starts from the paging structure cache, which it only reads.
+template <class Geometry>
+bool BasicVirtualMemory<Geometry>::optimistic_read (uint64_t virtual_address,
+                                                    word_t *value)
+{
+  uint64_t page = virtual_address >> geo.offsetWidth;
+  uint64_t page_offset = virtual_address & (geo.pageSize - 1);
+
+  for (int attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+  {
+    uint64_t version = table_lock.readBegin ();
+    count_event (page, &VMStats::table_walks);
+    word_t current_address = 0;
+    word_t next_address = 0;
+    bool mapped = true;
+
+    for (int level = psc_lookup (page, &current_address);
+         level < geo.tablesDepth; level++)
+    {
+      uint64_t offset =
+          (virtual_address >> ((geo.tablesDepth - level) * geo.offsetWidth))
+          & (geo.pageSize - 1);
+      pm.read (current_address * geo.pageSize + offset, &next_address);
+      if (huge_page_count != 0 && (next_address & HUGE_ENTRY))
+      {
+        next_address &= ~HUGE_ENTRY;
+        mapped = next_address >= frame_limit
+                 && (uint64_t) next_address + geo.pageSize <= geo.numFrames;
+        current_address = next_address + (word_t) (page & (geo.pageSize - 1));
+        break;
+      }
+      if (next_address <= 0 || (uint64_t) next_address >= geo.numFrames)
+      {
+        mapped = false;
+        break;
+      }
+      current_address = next_address;
+    }
+    if (mapped)
+    {
+      pm.read (current_address * geo.pageSize + page_offset, value);
+      // the first reference to a prefetched page is left to resolve_frame
+      if (readahead_max != 0
+          && loadShared (&prefetched_frames[current_address]))
+        mapped = false;
+    }
+
+    if (table_lock.readValidate (version))
+    {
+      if (!mapped) return false;
+      count_event (page, &VMStats::page_hits);
+      note_access (page, current_address);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::initialize ()
+{
+  stop_reclaimer ();
+  {
+    std::lock_guard<RwLock> hold (table_lock);
+    reset_state ();
+    clear_frame (START_FRAME);
+    pm.clearSwap ();
+#ifdef VM_CONCURRENT
+    // without tables the root frame is the only page frame
+    if (geo.tablesDepth == 0) pm.materialize (START_FRAME);
+#endif
+  }
+  start_reclaimer ();
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::initialize_with_swap_file (const char *path)
+{
+  int success;
+  {
+    std::lock_guard<RwLock> hold (table_lock);
+    success = pm.setSwapFile (path);
+  }
+  initialize ();
+  return success;
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::initialize_with_policy (
+    VMReplacementPolicy kind)
+{
+  std::unique_ptr<ReplacementPolicy> chosen = create_replacement_policy (kind);
+  if (!chosen)
+  {
+    return 0;
+  }
+  {
+    std::lock_guard<RwLock> hold (table_lock);
+    policy = std::move (chosen);
+    policy_kind = kind;
+  }
+  initialize ();
+  return 1;
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::initialize_with_reclaimer (
+    size_t low_watermark)
+{
+#ifndef VM_CONCURRENT
+  // without threads nothing could evict ahead of demand
+  if (low_watermark != 0)
+  {
+    return 0;
+  }
+#endif
+  // the pool is taken from the frames that could hold pages
+  if (low_watermark > geo.numFrames / 4)
+  {
+    return 0;
+  }
+  stop_reclaimer ();
+  reclaim_low = low_watermark;
+  initialize ();
+  return 1;
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::initialize_with_huge_pages (size_t count)
+{
+  // the blocks must leave the root and more frames than the tables above
+  // every huge page and above the one being mapped
+  if (count != 0
+      && (geo.tablesDepth < 2 || count * geo.pageSize >= geo.numFrames
+          || geo.numFrames - count * geo.pageSize
+             <= 1 + (count + 1) * (geo.tablesDepth - 2)))
+  {
+    return 0;
+  }
+  stop_reclaimer ();
+  huge_page_count = count;
+  initialize ();
+  return 1;
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::set_readahead (size_t max_pages)
+{
+  std::lock_guard<Mutex> hold (readahead_lock);
+  // a batch is prefetched while the one before it is still in use, and both
+  // have to fit next to the tables
+  readahead_max = std::min<size_t> (max_pages, geo.numFrames / 4);
+  stream = readahead_state ();
+  stream.window = std::min<size_t> (READAHEAD_INITIAL_WINDOW, readahead_max);
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::get_stats (VMStats *stats) const
+{
+  *stats = VMStats ();
+  for (int i = 0; i < TLB_SETS; ++i)
+  {
+    const VMStats &set = tlb_sets[i].stats;
+    stats->words_read += loadCounter (&set.words_read);
+    stats->words_written += loadCounter (&set.words_written);
+    stats->tlb_hits += loadCounter (&set.tlb_hits);
+    stats->tlb_misses += loadCounter (&set.tlb_misses);
+    stats->table_walks += loadCounter (&set.table_walks);
+    stats->page_hits += loadCounter (&set.page_hits);
+    stats->minor_faults += loadCounter (&set.minor_faults);
+    stats->major_faults += loadCounter (&set.major_faults);
+    stats->restores += loadCounter (&set.restores);
+    stats->frames_cleared += loadCounter (&set.frames_cleared);
+    stats->dfs_nodes += loadCounter (&set.dfs_nodes);
+    stats->clean_evictions += loadCounter (&set.clean_evictions);
+    stats->prefetches += loadCounter (&set.prefetches);
+    stats->prefetch_hits += loadCounter (&set.prefetch_hits);
+    stats->prefetch_wasted += loadCounter (&set.prefetch_wasted);
+    stats->direct_evictions += loadCounter (&set.direct_evictions);
+    stats->background_evictions += loadCounter (&set.background_evictions);
+    stats->huge_faults += loadCounter (&set.huge_faults);
+    stats->huge_evictions += loadCounter (&set.huge_evictions);
+    stats->psc_hits += loadCounter (&set.psc_hits);
+    stats->psc_levels_skipped += loadCounter (&set.psc_levels_skipped);
+  }
+  stats->writeback_bytes_saved =
+      stats->clean_evictions * geo.pageSize * sizeof (word_t);
+  stats->pm_reads = pm.readCount ();
+  stats->pm_writes = pm.writeCount ();
+}
+
+template <class Geometry>
+void BasicVirtualMemory<Geometry>::get_phase_timing (VMPhaseTiming *timing) const
+{
+  *timing = VMPhaseTiming ();
+#ifdef VM_PHASE_TIMING
+  for (int phase = 0; phase < VM_PHASE_COUNT; ++phase)
+  {
+    for (int i = 0; i < PHASE_BUCKETS; ++i)
+    {
+      timing->buckets[phase][i] =
+          loadCounter (&phase_times->buckets[phase][i]);
+    }
+  }
+#endif
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::read (uint64_t virtual_address, word_t *value)
+{
+  if (!is_address_legal (virtual_address))
+  {
+    return 0;
+  }
+  count_event (virtual_address >> geo.offsetWidth, &VMStats::words_read);
+#ifdef VM_CONCURRENT
+  if (optimistic_read (virtual_address, value))
+  {
+    return 1;
+  }
+#endif
+  page_access access;
+  {
+    RwLockGuard guard (table_lock);
+    uint64_t frame_addr = resolve_frame (virtual_address, guard, &access);
+    pm.read (frame_addr, value);
+  }
+  if (access != PAGE_HIT)
+  {
+    readahead (virtual_address >> geo.offsetWidth, access);
+  }
+  return 1;
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::write (uint64_t virtual_address, word_t value)
+{
+  if (!is_address_legal (virtual_address))
+  {
+    return 0;
+  }
+  count_event (virtual_address >> geo.offsetWidth, &VMStats::words_written);
+  page_access access;
+  {
+    RwLockGuard guard (table_lock);
+    uint64_t frame_addr = resolve_frame (virtual_address, guard, &access);
+    mark_dirty ((word_t) (frame_addr >> geo.offsetWidth));
+    pm.write (frame_addr, value);
+  }
+  if (access != PAGE_HIT)
+  {
+    readahead (virtual_address >> geo.offsetWidth, access);
+  }
+  return 1;
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::read_range (uint64_t virtual_address,
+                                              word_t *buf, size_t count)
+{
+  if (!is_range_legal (virtual_address, count))
+  {
+    return 0;
+  }
+  while (count > 0)
+  {
+    size_t run = geo.pageSize - virtual_address % geo.pageSize;
+    if (run > count) run = count;
+    count_event (virtual_address >> geo.offsetWidth, &VMStats::words_read,
+                 run);
+    page_access access;
+    {
+      RwLockGuard guard (table_lock);
+      uint64_t frame_addr = resolve_frame (virtual_address, guard, &access);
+      for (size_t i = 0; i < run; ++i)
+      {
+        pm.read (frame_addr + i, buf + i);
+      }
+    }
+    if (access != PAGE_HIT)
+    {
+      readahead (virtual_address >> geo.offsetWidth, access);
+    }
+    virtual_address += run;
+    buf += run;
+    count -= run;
+  }
+  return 1;
+}
+
+template <class Geometry>
+int BasicVirtualMemory<Geometry>::write_range (uint64_t virtual_address,
+                                               const word_t *buf,
+                                               size_t count)
+{
+  if (!is_range_legal (virtual_address, count))
+  {
+    return 0;
+  }
+  while (count > 0)
+  {
+    size_t run = geo.pageSize - virtual_address % geo.pageSize;
+    if (run > count) run = count;
+    count_event (virtual_address >> geo.offsetWidth, &VMStats::words_written,
+                 run);
+    page_access access;
+    {
+      RwLockGuard guard (table_lock);
+      uint64_t frame_addr = resolve_frame (virtual_address, guard, &access);
+      mark_dirty ((word_t) (frame_addr >> geo.offsetWidth));
+      for (size_t i = 0; i < run; ++i)
+      {
+        pm.write (frame_addr + i, buf[i]);
+      }
+    }
+    if (access != PAGE_HIT)
+    {
+      readahead (virtual_address >> geo.offsetWidth, access);
+    }
+    virtual_address += run;
+    buf += run;
+    count -= run;
+  }
+  return 1;
+}
+
+template class BasicVirtualMemory<MemoryGeometry>;
+#define INSTANTIATE_FIXED(O, P, V) \
+  template class BasicVirtualMemory<FixedGeometry<O, P, V> >;
+PREBUILT_GEOMETRIES (INSTANTIATE_FIXED)
+#undef INSTANTIATE_FIXED
+
+std::unique_ptr<VirtualMemory> create_virtual_memory (PhysicalMemory &pm)
+{
+  const MemoryGeometry &geometry = pm.geometry ();
+  try
+  {
+#define CREATE_FIXED(O, P, V)                                              \
+    if (geometry_matches (FixedGeometry<O, P, V> (), geometry))            \
+      return std::unique_ptr<VirtualMemory> (                              \
+          new BasicVirtualMemory<FixedGeometry<O, P, V> > (pm));
+    PREBUILT_GEOMETRIES (CREATE_FIXED)
+#undef CREATE_FIXED
+    return std::unique_ptr<VirtualMemory> (new DynamicVirtualMemory (pm));
+  }
+  catch (const std::bad_alloc &)
+  {
+    return std::unique_ptr<VirtualMemory> ();
+  }
+}
+
+std::unique_ptr<VirtualMemory> create_virtual_memory (int offset_width,
+                                                      int physical_address_width,
+                                                      int virtual_address_width)
+{
+  MemoryGeometry geometry (offset_width, physical_address_width,
+                           virtual_address_width);
+  if (!geometry.isValid ())
+  {
+    return std::unique_ptr<VirtualMemory> ();
+  }
+  // the RAM and the per frame and per page state of a valid geometry may
+  // still be too large to allocate
+  try
+  {
+#define CREATE_FIXED(O, P, V)                                              \
+    if (geometry_matches (FixedGeometry<O, P, V> (), geometry))            \
+      return std::unique_ptr<VirtualMemory> (                              \
+          new BasicVirtualMemory<FixedGeometry<O, P, V> > (geometry));
+    PREBUILT_GEOMETRIES (CREATE_FIXED)
+#undef CREATE_FIXED
+    return std::unique_ptr<VirtualMemory> (
+        new DynamicVirtualMemory (geometry));
+  }
+  catch (const std::bad_alloc &)
+  {
+    return std::unique_ptr<VirtualMemory> ();
+  }
+}
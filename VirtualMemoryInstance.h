@@ -0,0 +1,352 @@
+#pragma once
+
+#include "Locks.h"
+#include "MemoryGeometry.h"
+#include "PhysicalMemoryInstance.h"
+#include "ReplacementPolicy.h"
+#include "VMPhaseTiming.h"
+#include "VMPolicy.h"
+#include "VMStats.h"
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#ifdef VM_CONCURRENT
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+/*
+ * a virtual memory. every instance owns its page table state and (unless
+ * created on top of an existing one) its physical memory and swap, so any
+ * number of differently sized virtual memories can be used in one process.
+ *
+ * the methods behave like the VM* functions of VirtualMemory.h. when built
+ * with VM_CONCURRENT they may be called from several threads at once, except
+ * for the initialize methods and set_readahead.
+ */
+class VirtualMemory
+{
+ public:
+  virtual ~VirtualMemory ()
+  {}
+
+  virtual void initialize () = 0;
+  virtual int initialize_with_swap_file (const char *path) = 0;
+  virtual int initialize_with_policy (VMReplacementPolicy policy) = 0;
+  virtual int initialize_with_reclaimer (size_t low_watermark) = 0;
+  virtual int initialize_with_huge_pages (size_t count) = 0;
+  virtual void set_readahead (size_t max_pages) = 0;
+  virtual int read (uint64_t virtual_address, word_t *value) = 0;
+  virtual int write (uint64_t virtual_address, word_t value) = 0;
+  virtual int read_range (uint64_t virtual_address, word_t *buf,
+                          size_t count) = 0;
+  virtual int write_range (uint64_t virtual_address, const word_t *buf,
+                           size_t count) = 0;
+  virtual void get_stats (VMStats *stats) const = 0;
+  virtual void get_phase_timing (VMPhaseTiming *timing) const = 0;
+
+  virtual const MemoryGeometry &geometry () const = 0;
+  virtual PhysicalMemory &physical_memory () = 0;
+};
+
+/*
+ * creates a virtual memory with its own physical memory. geometries of the
+ * prebuilt configurations get a specialization with constant folded sizes,
+ * any other geometry gets the runtime sized implementation.
+ *
+ * returns NULL if the widths do not describe a valid geometry, or if the
+ * memory it simulates or the state of its pages and frames cannot be
+ * allocated.
+ */
+std::unique_ptr<VirtualMemory> create_virtual_memory (int offset_width,
+                                                      int physical_address_width,
+                                                      int virtual_address_width);
+
+/*
+ * creates a virtual memory on top of the given physical memory, picking the
+ * implementation as above.
+ *
+ * returns NULL if the state of its pages and frames cannot be allocated.
+ */
+std::unique_ptr<VirtualMemory> create_virtual_memory (PhysicalMemory &pm);
+
+/*
+ * the implementation of VirtualMemory, templated on either MemoryGeometry
+ * (sizes known at runtime) or a FixedGeometry (sizes known at compile time).
+ * it is explicitly instantiated in VirtualMemoryInstance.cpp for
+ * MemoryGeometry and for every prebuilt configuration.
+ */
+template <class Geometry>
+class BasicVirtualMemory final : public VirtualMemory
+{
+ public:
+  // creates a virtual memory with its own physical memory
+  explicit BasicVirtualMemory (const MemoryGeometry &geometry);
+  // creates a virtual memory on top of the given physical memory
+  explicit BasicVirtualMemory (PhysicalMemory &physical_memory);
+
+  ~BasicVirtualMemory ();
+
+  BasicVirtualMemory (const BasicVirtualMemory &) = delete;
+  BasicVirtualMemory &operator= (const BasicVirtualMemory &) = delete;
+
+  void initialize () override;
+  int initialize_with_swap_file (const char *path) override;
+  int initialize_with_policy (VMReplacementPolicy policy) override;
+  int initialize_with_reclaimer (size_t low_watermark) override;
+  int initialize_with_huge_pages (size_t count) override;
+  void set_readahead (size_t max_pages) override;
+  int read (uint64_t virtual_address, word_t *value) override;
+  int write (uint64_t virtual_address, word_t value) override;
+  int read_range (uint64_t virtual_address, word_t *buf,
+                  size_t count) override;
+  int write_range (uint64_t virtual_address, const word_t *buf,
+                   size_t count) override;
+  void get_stats (VMStats *stats) const override;
+  void get_phase_timing (VMPhaseTiming *timing) const override;
+
+  const MemoryGeometry &geometry () const override
+  { return pm.geometry (); }
+  PhysicalMemory &physical_memory () override
+  { return pm; }
+
+ private:
+  struct tlb_entry
+  {
+      uint64_t page;
+      word_t frame;
+      uint64_t last_used;
+      bool valid;
+  };
+
+  // per TLB set state. the events of every page are counted in the set the
+  // page maps to, so threads working on different pages rarely share a
+  // counter
+  struct tlb_set
+  {
+      SpinLock lock;
+      uint64_t clock;
+      VMStats stats;
+  };
+
+  // reverse map entry: where a frame is linked in the page table
+  struct frame_link
+  {
+      word_t parent_frame;
+      uint64_t entry_index;
+      int level;
+      uint64_t page;
+      bool linked;
+  };
+
+  // a reserved block of frames and the region of pages it maps, if any
+  struct huge_page
+  {
+      uint64_t region;
+      word_t parent_frame;
+      uint64_t entry_index;
+      bool mapped;
+  };
+
+  // a frame the reclaimer unlinked but did not write back yet
+  struct writeback
+  {
+      word_t frame;
+      uint64_t page;
+      bool dirty;
+  };
+
+  struct dfs_result
+  {
+      word_t max_frame_taken;
+      word_t max_cyclic_page;
+      word_t max_cyclic_frame;
+      word_t max_cyclic_dist;
+      word_t empty_frame;
+  };
+
+  // how a page was found when it was referenced
+  enum page_access
+  {
+      PAGE_HIT,
+      // the first reference to a page that readahead mapped
+      PREFETCHED_HIT,
+      MINOR_FAULT,
+      MAJOR_FAULT
+  };
+
+  // the fault stream readahead follows. a stream is confirmed by two
+  // successive faults stride pages apart. while streaming, next_page is the
+  // first page not prefetched yet and the first reference to trigger_page,
+  // the first page of the last batch, prefetches the next batch.
+  struct readahead_state
+  {
+      uint64_t last_page;
+      int64_t stride;
+      bool streaming;
+      uint64_t next_page;
+      uint64_t trigger_page;
+      size_t window;
+  };
+
+  void reset_state ();
+  bool is_address_legal (uint64_t virtual_address) const;
+  bool is_range_legal (uint64_t virtual_address, size_t count) const;
+  uint64_t calculate_cyclic_distance (uint64_t in_page,
+                                      uint64_t ref_page) const;
+  void clear_frame (word_t frame);
+  void process_leaf (word_t frame, uint64_t page, uint64_t path,
+                     dfs_result *result);
+  void dfs (int level, uint64_t page, word_t frame, uint64_t parent,
+            dfs_result *result, uint64_t path);
+  void link_frame (word_t frame, word_t parent_frame, uint64_t entry_index,
+                   int level, uint64_t page);
+  void remove_frame (word_t target_frame);
+  void mark_table_empty (word_t frame, bool empty);
+  word_t find_empty_table (word_t parent);
+  void set_page_swapped (uint64_t page, bool swapped);
+  bool is_page_swapped (uint64_t page) const;
+  word_t locate_available_frame (uint64_t parent, uint64_t page);
+  word_t take_free_frame (uint64_t page);
+  void write_back (word_t victim);
+  void evict_page (word_t frame, uint64_t page, bool dirty);
+  void restore_page (word_t frame, uint64_t page);
+  void release_victim (word_t victim);
+  void wait_for_writeback (uint64_t page);
+  void start_reclaimer ();
+  void stop_reclaimer ();
+  void reclaim_loop ();
+  void reclaim ();
+  word_t map_huge_page (word_t parent, uint64_t entry_index, uint64_t page,
+                        bool *restored);
+  void evict_huge_page (size_t block);
+  word_t link_fresh_frame (word_t parent, uint64_t entry_index, int level,
+                           uint64_t page);
+  bool walk_tables (uint64_t virtual_address, bool exclusive, word_t *frame,
+                    page_access *access);
+  page_access map_page (uint64_t virtual_address, RwLockGuard &guard,
+                        word_t *frame);
+  uint64_t resolve_frame (uint64_t virtual_address, RwLockGuard &guard,
+                          page_access *access);
+  void readahead (uint64_t page, page_access access);
+  void prefetch (uint64_t first_page, int64_t stride, size_t count);
+  bool optimistic_read (uint64_t virtual_address, word_t *value);
+  void note_access (uint64_t page, word_t frame);
+  void mark_dirty (word_t frame);
+  void count_event (uint64_t page, uint64_t VMStats::*counter,
+                    uint64_t amount = 1);
+  int psc_lookup (uint64_t page, word_t *frame);
+  void psc_insert (int level, uint64_t page, word_t frame);
+  void psc_invalidate (int level, uint64_t prefix);
+  bool tlb_lookup (uint64_t page, word_t *frame);
+  void tlb_insert (uint64_t page, word_t frame);
+  void tlb_invalidate_page (uint64_t page);
+  void tlb_invalidate_region (uint64_t region);
+  void tlb_flush ();
+
+  std::unique_ptr<PhysicalMemory> owned_pm;
+  PhysicalMemory &pm;
+  Geometry geo;
+
+  // every access holds table_lock shared. a fault that can be served by
+  // never used frames also holds the lock of its fault shard, chosen by the
+  // top level table entry, and alloc_lock while it takes a frame. faults
+  // that reuse or evict frames linked elsewhere upgrade to table_lock
+  // exclusive. all of these are no-ops unless VM_CONCURRENT is defined.
+  // reads of resident pages skip table_lock and validate against its
+  // sequence counter instead, see optimistic_read.
+  RwLock table_lock;
+  std::unique_ptr<Mutex[]> fault_shards;
+  Mutex alloc_lock;
+
+  std::vector<tlb_entry> tlb;
+  std::unique_ptr<tlb_set[]> tlb_sets;
+#ifdef VM_PHASE_TIMING
+  // the latency histograms of the fault path, bumped like the counters of
+  // tlb_sets but shared by every thread
+  std::unique_ptr<VMPhaseTiming> phase_times;
+#endif
+  // the paging structure cache: PSC_ENTRIES direct mapped entries for each
+  // level of tables below the root, mapping the prefix of the virtual
+  // address that selects a table of that level to its frame. an entry holds
+  // the prefix in its upper and the frame in its lower 32 bits, 0 if it is
+  // empty, so walks holding table_lock shared can fill it without a lock.
+  // tables are only unlinked with table_lock held exclusively, and unlinking
+  // one drops its entry. psc_enabled is false if the prefixes do not fit.
+  std::vector<uint64_t> psc;
+  bool psc_enabled;
+  // the TLB of huge pages, fully associative, mapping regions to the first
+  // frame of their block
+  std::vector<tlb_entry> huge_tlb;
+  SpinLock huge_tlb_lock;
+  uint64_t huge_tlb_clock;
+  std::vector<frame_link> reverse_map;
+
+  // incremental allocator state: frames below next_unused_frame are in use,
+  // table_entries counts the non-zero entries of each table frame and
+  // empty_tables marks linked table frames that currently have none
+  word_t next_unused_frame;
+  std::vector<int> table_entries;
+  std::vector<uint64_t> empty_tables;
+
+  // chooses the pages to evict. it sees every leaf linked and unlinked and,
+  // if policy_tracks_accesses, every reference to a resident page
+  std::unique_ptr<ReplacementPolicy> policy;
+  VMReplacementPolicy policy_kind;
+  bool policy_tracks_accesses;
+
+  // the frames from frame_limit up are reserved for huge_page_count huge
+  // pages of pageSize frames each. while there are any, every region of
+  // pageSize pages is mapped by a single entry in the next to last level of
+  // tables, in place of a last level table, which holds the first frame of
+  // its block and HUGE_ENTRY. huge pages are replaced among themselves, by
+  // the cyclic distance of their regions, and are not seen by the policy.
+  size_t huge_page_count;
+  word_t frame_limit;
+  std::vector<huge_page> huge_pages;
+
+  // pages that were evicted and have to be restored on their next reference
+  std::vector<uint64_t> swapped_pages;
+  // page frames written since their page was mapped
+  std::vector<uint8_t> dirty_frames;
+
+  // readahead is off while readahead_max is 0. prefetched_frames marks page
+  // frames mapped by readahead and not referenced since, and
+  // readahead_wasted is set when such a frame is evicted, to shrink the
+  // window. the stream is only followed under readahead_lock, which is never
+  // taken while table_lock is held.
+  size_t readahead_max;
+  Mutex readahead_lock;
+  readahead_state stream;
+  std::vector<uint8_t> prefetched_frames;
+  uint8_t readahead_wasted;
+
+  // frames the reclaimer evicted ahead of demand, handed out under
+  // alloc_lock once the never used frames run out. while fewer than
+  // reclaim_low are left the reclaimer refills the pool to twice that,
+  // choosing victims as if reclaim_hint, the page of the latest fault that
+  // took a frame, was faulting. reclaim_low is 0 while the reclaimer is off.
+  std::vector<word_t> free_frames;
+  size_t reclaim_low;
+  uint64_t reclaim_hint;
+#ifdef VM_CONCURRENT
+  // the reclaimer writes victims back without holding table_lock, after
+  // unlinking them under it. writeback_pages marks their pages until the
+  // write is done, and a fault restoring one of them waits for
+  // writeback_done. reclaim_mutex guards writeback_pages and the flags and
+  // is taken after table_lock and alloc_lock, never before them.
+  std::thread reclaimer;
+  std::mutex reclaim_mutex;
+  std::condition_variable reclaim_wakeup;
+  std::condition_variable writeback_done;
+  bool reclaim_requested;
+  bool reclaim_stop;
+  std::vector<uint64_t> writeback_pages;
+#endif
+};
+
+// the runtime sized implementation
+typedef BasicVirtualMemory<MemoryGeometry> DynamicVirtualMemory;